@@ -15,27 +15,23 @@ struct PixelShader : public PixelShaderBase<PixelShader>
 {
     static const int AVarCount = 3;
 
-    static std::vector<int> buffer;
-    static int width;
-    static int height;
+    int* buffer;
+    int width;
+    int height;
 
-    static void drawPixel(const PixelData& p)
+    void drawPixel(const PixelData& p) const
     {
         buffer[p.x + width * p.y] = 1;
     }
 };
 
-std::vector<int> PixelShader::buffer;
-int PixelShader::width;
-int PixelShader::height;
-
 struct VertexShader : public VertexShaderBase<VertexShader>
 {
     static const int AttribCount = 1;
     static const int AVarCount = 3;
     static const int PVarCount = 0;
 
-    static void processVertex(VertexShaderInput in, VertexShaderOutput* out)
+    void processVertex(VertexShaderInput in, VertexShaderOutput* out) const
     {
         const VertexData* data = static_cast<const VertexData*>(in[0]);
         out->x = data->x;
@@ -65,9 +61,14 @@ private:
 public:
     void Run()
     {
-        PixelShader::buffer.resize(640 * 480);
-        PixelShader::width = 640;
-        PixelShader::height = 480;
+        std::vector<int> buffer(640 * 480);
+
+        PixelShader pixelShader;
+        pixelShader.buffer = &buffer[0];
+        pixelShader.width = 640;
+        pixelShader.height = 480;
+
+        VertexShader vertexShader;
 
         Rasterizer r;
         VertexProcessor v(&r);
@@ -94,8 +95,8 @@ public:
             indices.push_back(offset + 2);
         }
 
-        r.setPixelShader<PixelShader>();
-        v.setVertexShader<VertexShader>();
+        r.setPixelShader(&pixelShader);
+        v.setVertexShader(&vertexShader);
         v.setVertexAttribPointer(0, sizeof(VertexData), &vertices[0]);
 
         auto start = std::chrono::steady_clock::now();
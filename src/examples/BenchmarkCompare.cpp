@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Compares two CSV files written by BenchmarkSuite and flags configurations
+// whose median frame time grew by more than the threshold, 5% by default.
+// Returns 1 if there are regressions.
+// Usage: BenchmarkCompare baseline.csv current.csv [threshold]
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Columns identifying a configuration
+const char *const KeyColumns[] = { "scene", "mode", "width", "height", "threads", "varyings" };
+
+std::vector<std::string> splitLine(const std::string &line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ','))
+        fields.push_back(field);
+    return fields;
+}
+
+// Median milliseconds by configuration, in file order
+bool readResults(const char *path, std::vector<std::string> &keys, std::map<std::string, double> &medians)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line)) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return false;
+    }
+
+    std::vector<std::string> header = splitLine(line);
+    std::map<std::string, size_t> columns;
+    for (size_t i = 0; i < header.size(); ++i)
+        columns[header[i]] = i;
+
+    std::vector<size_t> keyColumns;
+    for (const char *name : KeyColumns) {
+        if (!columns.count(name)) {
+            fprintf(stderr, "%s has no %s column\n", path, name);
+            return false;
+        }
+        keyColumns.push_back(columns[name]);
+    }
+
+    if (!columns.count("median_ms")) {
+        fprintf(stderr, "%s has no median_ms column\n", path);
+        return false;
+    }
+    size_t medianColumn = columns["median_ms"];
+
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = splitLine(line);
+        if (fields.size() != header.size())
+            continue;
+
+        std::string key;
+        for (size_t column : keyColumns)
+            key += (key.empty() ? "" : " ") + fields[column];
+
+        if (!medians.count(key))
+            keys.push_back(key);
+        medians[key] = std::atof(fields[medianColumn].c_str());
+    }
+
+    return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: BenchmarkCompare baseline.csv current.csv [threshold]\n");
+        return 2;
+    }
+
+    double threshold = argc > 3 ? std::atof(argv[3]) : 0.05;
+
+    std::vector<std::string> baselineKeys, currentKeys;
+    std::map<std::string, double> baseline, current;
+    if (!readResults(argv[1], baselineKeys, baseline) || !readResults(argv[2], currentKeys, current))
+        return 2;
+
+    int regressions = 0;
+    int improvements = 0;
+
+    printf("%-44s %12s %12s %9s\n", "configuration", "baseline ms", "current ms", "change");
+    for (const std::string &key : currentKeys) {
+        auto match = baseline.find(key);
+        if (match == baseline.end()) {
+            printf("%-44s %12s %12.3f %9s\n", key.c_str(), "-", current[key], "new");
+            continue;
+        }
+
+        double before = match->second;
+        double after = current[key];
+        double change = before > 0.0 ? after / before - 1.0 : 0.0;
+
+        const char *status = "";
+        if (change > threshold) {
+            status = "  REGRESSION";
+            regressions++;
+        } else if (change < -threshold) {
+            status = "  improved";
+            improvements++;
+        }
+
+        printf("%-44s %12.3f %12.3f %+8.1f%%%s\n", key.c_str(), before, after, change * 100.0, status);
+    }
+
+    for (const std::string &key : baselineKeys)
+        if (!current.count(key))
+            printf("%-44s %12.3f %12s %9s\n", key.c_str(), baseline[key], "-", "missing");
+
+    printf("%d regressions and %d improvements beyond %.1f%%\n", regressions, improvements, threshold * 100.0);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,672 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Renders synthetic scenes over a sweep of raster modes, resolutions, thread
+// counts and varying counts and reports frame times with primitive and pixel
+// rates as CSV or JSON. Use BenchmarkCompare to check CSV results against a
+// saved baseline. With a renderer built with SWR_STATISTICS the pipeline
+// statistics of one frame per configuration are printed as well.
+// Usage: BenchmarkSuite [options]
+//   --scenes tiny,medium,huge,strip,textured,depth,lines,points,meshlets
+//   --modes span,block,adaptive
+//   --resolutions 640x480,1280x720
+//   --threads 1,4            0 is the number of hardware threads
+//   --varyings 4             0, 2, 4, 8 or 16 affine variables
+//   --trials 10 --warmup 2   timed and untimed frames per configuration
+//   --format csv|json --output file
+
+#include "Renderer.h"
+#include "MeshOptimizer.h"
+#include "Texture.h"
+#include "Random.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace swr;
+
+namespace {
+
+const int MaxVaryings = 16;
+const int TextureSize = 256;
+
+struct Vertex {
+    float x, y, z, w;
+    float u, v;
+    float varyings[MaxVaryings];
+};
+
+struct Scene {
+    std::string name;
+    DrawMode mode;
+    bool textured;
+    bool depthTest;
+    CullMode cullMode;
+    std::vector<Vertex> vertices;
+    std::vector<int> indices;
+    std::vector<Meshlet> meshlets;  // drawn with drawMeshlets() if not empty
+
+    size_t primitiveCount() const
+    {
+        size_t perPrimitive = mode == DrawMode::Triangle ? 3 : mode == DrawMode::Line ? 2 : 1;
+        return indices.size() / perPrimitive;
+    }
+};
+
+struct Config {
+    std::string scene;
+    RasterMode mode;
+    int width, height;
+    int threads;
+    int varyings;
+};
+
+struct Result {
+    Config config;
+    size_t primitives;
+    uint64_t pixels;
+    int trials;
+    double medianMs, p99Ms, minMs, meanMs;
+};
+
+const char *modeName(RasterMode mode)
+{
+    switch (mode) {
+    case RasterMode::Span: return "span";
+    case RasterMode::Block: return "block";
+    default: return "adaptive";
+    }
+}
+
+template <int VaryingCount, bool Textured>
+class VertexShader : public VertexShaderBase<VertexShader<VaryingCount, Textured> > {
+public:
+    static const int AttribCount = 1;
+    static const int AVarCount = VaryingCount;
+    static const int PVarCount = Textured ? 2 : 0;
+
+    void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
+    {
+        const Vertex *data = static_cast<const Vertex*>(in[0]);
+        out->x = data->x;
+        out->y = data->y;
+        out->z = data->z;
+        out->w = data->w;
+        for (int i = 0; i < VaryingCount; ++i)
+            out->avar[i] = data->varyings[i];
+        if (Textured) {
+            out->pvar[0] = data->u;
+            out->pvar[1] = data->v;
+        }
+    }
+};
+
+// Gray level from the varyings. Shaded pixels are only counted while
+// pixelCounter is set, which is never during timed frames.
+template <int VaryingCount>
+inline uint32_t shadeVaryings(const PixelData &p, std::atomic<uint64_t> *pixelCounter)
+{
+    if (pixelCounter)
+        pixelCounter->fetch_add(1, std::memory_order_relaxed);
+
+    float sum = 1.0f;
+    for (int i = 0; i < VaryingCount; ++i)
+        sum += p.avar[i];
+    uint32_t gray = (uint32_t)(sum * (255.0f / (VaryingCount + 1))) & 0xff;
+    return 0xff000000 | gray * 0x010101;
+}
+
+template <int VaryingCount>
+class ColorShader : public PixelShaderBase<ColorShader<VaryingCount> > {
+public:
+    static const bool InterpolateZ = true;
+    static const bool InterpolateW = false;
+    static const int AVarCount = VaryingCount;
+    static const int PVarCount = 0;
+    static const bool ColorOutput = true;
+
+    std::atomic<uint64_t> *pixelCounter = nullptr;
+
+    uint32_t shadePixel(const PixelData &p) const
+    {
+        return shadeVaryings<VaryingCount>(p, pixelCounter);
+    }
+};
+
+template <int VaryingCount>
+class TextureShader : public PixelShaderBase<TextureShader<VaryingCount> > {
+public:
+    static const bool InterpolateZ = true;
+    static const bool InterpolateW = true;
+    static const int AVarCount = VaryingCount;
+    static const int PVarCount = 2;
+    static const bool ColorOutput = true;
+    static const int SegmentSize = 4;
+
+    std::atomic<uint64_t> *pixelCounter = nullptr;
+    const Texture *texture;
+
+    struct Segment {
+        TextureFootprint footprint;
+    };
+
+    void beginSegment(const PixelData &p, Segment &segment) const
+    {
+        float dudx, dudy, dvdx, dvdy;
+        p.computePerspectiveDerivatives(*p.equations, 0, dudx, dudy);
+        p.computePerspectiveDerivatives(*p.equations, 1, dvdx, dvdy);
+        segment.footprint = texture->footprint(dudx, dvdx, dudy, dvdy);
+    }
+
+    uint32_t shadePixel(const PixelData &p) const
+    {
+        uint32_t color;
+        texture->sample(p.pvar[0], p.pvar[1], TextureShader::segment(p).footprint, color);
+        return color & shadeVaryings<VaryingCount>(p, pixelCounter);
+    }
+};
+
+class SceneBuilder {
+public:
+    SceneBuilder(Scene &scene, int width, int height)
+        : m_scene(scene), m_width(width), m_height(height), m_random(0)
+    {
+    }
+
+    float next(float min, float max)
+    {
+        return min + (max - min) * (float)m_random.NextDouble();
+    }
+
+    // Add a vertex at pixel (px, py) with depth z in [0, 1], scaled by w
+    // for perspective interpolation. Textures map about one texel to a pixel.
+    int addVertex(float px, float py, float z, float w = 1.0f)
+    {
+        Vertex vertex;
+        vertex.x = (px / m_width * 2.0f - 1.0f) * w;
+        vertex.y = (1.0f - py / m_height * 2.0f) * w;
+        vertex.z = (z * 2.0f - 1.0f) * w;
+        vertex.w = w;
+        vertex.u = px / TextureSize;
+        vertex.v = py / TextureSize;
+        for (int i = 0; i < MaxVaryings; ++i)
+            vertex.varyings[i] = next(0.0f, 1.0f);
+
+        m_scene.vertices.push_back(vertex);
+        return (int)m_scene.vertices.size() - 1;
+    }
+
+    // Equilateral triangles with the given area in pixels at random places
+    void addTriangles(size_t count, float area, float maxW = 1.0f)
+    {
+        float radius = std::sqrt(4.0f * area / (3.0f * std::sqrt(3.0f)));
+        for (size_t i = 0; i < count; ++i) {
+            float cx = next(0.0f, (float)m_width);
+            float cy = next(0.0f, (float)m_height);
+            float z = next(0.0f, 1.0f);
+            float angle = next(0.0f, 6.2831853f);
+            for (int k = 0; k < 3; ++k) {
+                float a = angle + k * 2.0943951f;
+                m_scene.indices.push_back(addVertex(cx + radius * std::cos(a), cy + radius * std::sin(a), z, next(1.0f, maxW)));
+            }
+        }
+    }
+
+    // Grid of cellSize pixel quads covering the screen, with the vertices
+    // shared between neighbouring triangles like in a triangle strip.
+    void addGrid(int cellSize, float z)
+    {
+        int columns = (m_width + cellSize - 1) / cellSize;
+        int rows = (m_height + cellSize - 1) / cellSize;
+        int first = (int)m_scene.vertices.size();
+
+        for (int y = 0; y <= rows; ++y)
+            for (int x = 0; x <= columns; ++x)
+                addVertex((float)(x * cellSize), (float)(y * cellSize), z);
+
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < columns; ++x) {
+                int i0 = first + y * (columns + 1) + x;
+                int i1 = i0 + columns + 1;
+                int quad[6] = { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 };
+                m_scene.indices.insert(m_scene.indices.end(), quad, quad + 6);
+            }
+        }
+    }
+
+    // Sphere around pixel (cx, cy) and depth cz with a radius of radius
+    // pixels and depthRadius in depth, counter clockwise seen from outside.
+    void addSphere(float cx, float cy, float cz, float radius, float depthRadius, int rings, int segments)
+    {
+        int first = (int)m_scene.vertices.size();
+        for (int ring = 0; ring <= rings; ++ring) {
+            float theta = 3.1415927f * ring / rings;
+            for (int segment = 0; segment <= segments; ++segment) {
+                float phi = 6.2831853f * segment / segments;
+                addVertex(cx + radius * std::sin(theta) * std::cos(phi), cy + radius * std::cos(theta),
+                    cz + depthRadius * std::sin(theta) * std::sin(phi));
+            }
+        }
+
+        for (int ring = 0; ring < rings; ++ring) {
+            for (int segment = 0; segment < segments; ++segment) {
+                int i0 = first + ring * (segments + 1) + segment;
+                int i1 = i0 + segments + 1;
+                int quad[6] = { i0, i0 + 1, i1, i0 + 1, i1 + 1, i1 };
+                m_scene.indices.insert(m_scene.indices.end(), quad, quad + 6);
+            }
+        }
+    }
+
+    void addLines(size_t count, float length)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            float x = next(0.0f, (float)m_width);
+            float y = next(0.0f, (float)m_height);
+            float z = next(0.0f, 1.0f);
+            float angle = next(0.0f, 6.2831853f);
+            m_scene.indices.push_back(addVertex(x, y, z));
+            m_scene.indices.push_back(addVertex(x + length * std::cos(angle), y + length * std::sin(angle), z));
+        }
+    }
+
+    void addPoints(size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            m_scene.indices.push_back(addVertex(next(0.0f, (float)m_width), next(0.0f, (float)m_height), next(0.0f, 1.0f)));
+    }
+
+private:
+    Scene &m_scene;
+    int m_width, m_height;
+    Random m_random;
+};
+
+bool buildScene(Scene &scene, const std::string &name, int width, int height)
+{
+    scene.name = name;
+    scene.mode = DrawMode::Triangle;
+    scene.textured = false;
+    scene.depthTest = false;
+    scene.cullMode = CullMode::None;
+
+    SceneBuilder builder(scene, width, height);
+    if (name == "tiny") {
+        builder.addTriangles(100000, 2.0f);
+    } else if (name == "medium") {
+        builder.addTriangles(20000, 200.0f);
+    } else if (name == "huge") {
+        builder.addTriangles(64, 0.5f * width * height);
+    } else if (name == "strip") {
+        for (int layer = 0; layer < 4; ++layer)
+            builder.addGrid(8, 0.5f);
+    } else if (name == "textured") {
+        scene.textured = true;
+        builder.addTriangles(5000, 200.0f, 4.0f);
+    } else if (name == "depth") {
+        // Full screen layers in random depth order, most fail the depth test
+        scene.depthTest = true;
+        for (int layer = 0; layer < 32; ++layer)
+            builder.addGrid(std::max(width, height), builder.next(0.0f, 1.0f));
+    } else if (name == "meshlets") {
+        // Spheres reaching past the screen edges, large ones in front of
+        // small ones. drawMeshlets() culls meshlets outside the frustum,
+        // facing away or hidden in the Hi-Z buffer of the previous frame.
+        scene.depthTest = true;
+        scene.cullMode = CullMode::CW;
+        float unit = 0.5f * std::min(width, height);
+        for (int i = 0; i < 8; ++i)
+            builder.addSphere(builder.next(0.0f, (float)width), builder.next(0.0f, (float)height), 0.25f, 0.8f * unit, 0.2f, 32, 64);
+        for (int i = 0; i < 150; ++i)
+            builder.addSphere(builder.next(-0.2f * width, 1.2f * width), builder.next(-0.2f * height, 1.2f * height),
+                builder.next(0.5f, 0.8f), builder.next(0.05f, 0.2f) * unit, 0.1f, 16, 32);
+        buildMeshlets(scene.meshlets, &scene.indices[0], &scene.indices[0], scene.indices.size(), &scene.vertices[0].x,
+            scene.vertices.size(), sizeof(Vertex));
+    } else if (name == "lines") {
+        scene.mode = DrawMode::Line;
+        builder.addLines(20000, 64.0f);
+    } else if (name == "points") {
+        scene.mode = DrawMode::Point;
+        builder.addPoints(100000);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<Texture> createTexture()
+{
+    std::vector<uint32_t> pixels(TextureSize * TextureSize);
+    for (int y = 0; y < TextureSize; ++y)
+        for (int x = 0; x < TextureSize; ++x)
+            pixels[y * TextureSize + x] = ((x ^ y) & 16) ? 0xffe0c080 : 0xff406080;
+    return std::make_shared<Texture>(&pixels[0], TextureSize, TextureSize, TextureSize * 4);
+}
+
+void printStatistics(const PipelineStatistics &s)
+{
+    fprintf(stderr, "  vertices fetched %llu shaded %llu cache hits %llu\n", (unsigned long long)s.verticesFetched,
+        (unsigned long long)s.verticesShaded, (unsigned long long)s.vertexCacheHits);
+    fprintf(stderr, "  primitives clipped %llu culled %llu from clipping %llu, triangles set up %llu\n",
+        (unsigned long long)s.primitivesClipped, (unsigned long long)s.primitivesCulled, (unsigned long long)s.clipperOutput,
+        (unsigned long long)s.trianglesSetUp);
+    fprintf(stderr, "  blocks empty %llu partial %llu full %llu\n", (unsigned long long)s.emptyBlocks,
+        (unsigned long long)s.partialBlocks, (unsigned long long)s.fullBlocks);
+    fprintf(stderr, "  pixels tested %llu shaded %llu written %llu\n", (unsigned long long)s.pixelsTested,
+        (unsigned long long)s.pixelsShaded, (unsigned long long)s.pixelsWritten);
+    fprintf(stderr, "  ms vertex %.3f clip %.3f setup %.3f raster %.3f\n", s.vertexNs / 1e6, s.clipNs / 1e6,
+        s.setupNs / 1e6, s.rasterNs / 1e6);
+}
+
+template <class PixelShader, class VertexShader>
+Result run(const Config &config, const Scene &scene, PixelShader &pixelShader, int trials, int warmup)
+{
+    ThreadPoolConfig poolConfig;
+    poolConfig.threadCount = config.threads;
+    ThreadPool pool(poolConfig);
+
+    RenderTarget colorTarget(config.width, config.height, RenderTargetFormat::RGBA8);
+    RenderTarget depthTarget(config.width, config.height, RenderTargetFormat::D32F);
+
+    VertexShader vertexShader;
+    Rasterizer r(&pool);
+    VertexProcessor v(&r, &pool);
+
+    DepthState depthState;
+    depthState.depthTest = scene.depthTest;
+    depthState.depthWrite = scene.depthTest;
+
+    r.setRenderTargets(&colorTarget, scene.depthTest ? &depthTarget : nullptr);
+    r.setDepthState(depthState);
+    r.setRasterMode(config.mode);
+    r.setScissorRect(0, 0, config.width, config.height);
+    r.setPixelShader(&pixelShader);
+
+    v.setViewport(0, 0, config.width, config.height);
+    v.setCullMode(scene.cullMode);
+    v.setVertexShader(&vertexShader);
+    v.setVertexAttribPointer(0, sizeof(Vertex), &scene.vertices[0]);
+
+    // The vertices are in clip space already
+    static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    HiZBuffer hiZBuffer;
+    v.setHiZBuffer(&hiZBuffer);
+
+    auto frame = [&]() {
+        colorTarget.clear(0xff000000);
+        if (scene.depthTest)
+            depthTarget.clearDepth(1.0f);
+        if (scene.meshlets.empty()) {
+            v.drawElements(scene.mode, scene.indices.size(), &scene.indices[0]);
+        } else {
+            v.drawMeshlets(&scene.meshlets[0], scene.meshlets.size(), &scene.indices[0], identity);
+            hiZBuffer.update(depthTarget);
+        }
+    };
+
+    // Counted and timed frames all cull with the Hi-Z buffer of a frame
+    if (!scene.meshlets.empty())
+        frame();
+
+    // Count the shaded pixels once, outside the timed frames
+    std::atomic<uint64_t> pixelCounter(0);
+    pixelShader.pixelCounter = &pixelCounter;
+    resetStatistics();
+    frame();
+    pixelShader.pixelCounter = nullptr;
+
+    if (StatisticsEnabled)
+        printStatistics(collectStatistics());
+
+    for (int i = 0; i < warmup; ++i)
+        frame();
+
+    std::vector<double> times;
+    for (int i = 0; i < trials; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        frame();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+
+    Result result;
+    result.config = config;
+    result.config.threads = pool.threadCount();
+    result.primitives = scene.primitiveCount();
+    result.pixels = pixelCounter.load();
+    result.trials = trials;
+    result.medianMs = n % 2 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    result.p99Ms = times[std::min(n - 1, (size_t)std::ceil(0.99 * n) - 1)];
+    result.minMs = times[0];
+    result.meanMs = 0.0;
+    for (double t : times)
+        result.meanMs += t / n;
+    return result;
+}
+
+template <int VaryingCount>
+Result runVaryings(const Config &config, const Scene &scene, const Texture *texture, int trials, int warmup)
+{
+    if (scene.textured) {
+        TextureShader<VaryingCount> pixelShader;
+        pixelShader.texture = texture;
+        return run<TextureShader<VaryingCount>, VertexShader<VaryingCount, true> >(config, scene, pixelShader, trials, warmup);
+    }
+
+    ColorShader<VaryingCount> pixelShader;
+    return run<ColorShader<VaryingCount>, VertexShader<VaryingCount, false> >(config, scene, pixelShader, trials, warmup);
+}
+
+bool runConfig(Result &result, const Config &config, const Scene &scene, const Texture *texture, int trials, int warmup)
+{
+    switch (config.varyings) {
+    case 0: result = runVaryings<0>(config, scene, texture, trials, warmup); return true;
+    case 2: result = runVaryings<2>(config, scene, texture, trials, warmup); return true;
+    case 4: result = runVaryings<4>(config, scene, texture, trials, warmup); return true;
+    case 8: result = runVaryings<8>(config, scene, texture, trials, warmup); return true;
+    case 16: result = runVaryings<16>(config, scene, texture, trials, warmup); return true;
+    default: return false;
+    }
+}
+
+std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+void writeCsv(FILE *file, const std::vector<Result> &results)
+{
+    fprintf(file, "scene,mode,width,height,threads,varyings,primitives,pixels,trials,"
+        "median_ms,p99_ms,min_ms,mean_ms,primitives_per_s,pixels_per_s\n");
+    for (const Result &r : results) {
+        double seconds = r.medianMs / 1000.0;
+        fprintf(file, "%s,%s,%d,%d,%d,%d,%zu,%llu,%d,%.4f,%.4f,%.4f,%.4f,%.0f,%.0f\n",
+            r.config.scene.c_str(), modeName(r.config.mode), r.config.width, r.config.height, r.config.threads,
+            r.config.varyings, r.primitives, (unsigned long long)r.pixels, r.trials, r.medianMs, r.p99Ms, r.minMs,
+            r.meanMs, r.primitives / seconds, r.pixels / seconds);
+    }
+}
+
+void writeJson(FILE *file, const std::vector<Result> &results)
+{
+    fprintf(file, "[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        double seconds = r.medianMs / 1000.0;
+        fprintf(file, "  {\"scene\": \"%s\", \"mode\": \"%s\", \"width\": %d, \"height\": %d, \"threads\": %d, "
+            "\"varyings\": %d, \"primitives\": %zu, \"pixels\": %llu, \"trials\": %d, \"median_ms\": %.4f, "
+            "\"p99_ms\": %.4f, \"min_ms\": %.4f, \"mean_ms\": %.4f, \"primitives_per_s\": %.0f, \"pixels_per_s\": %.0f}%s\n",
+            r.config.scene.c_str(), modeName(r.config.mode), r.config.width, r.config.height, r.config.threads,
+            r.config.varyings, r.primitives, (unsigned long long)r.pixels, r.trials, r.medianMs, r.p99Ms, r.minMs,
+            r.meanMs, r.primitives / seconds, r.pixels / seconds, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "]\n");
+}
+
+} // end anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> scenes = split("tiny,medium,huge,strip,textured,depth,lines,points,meshlets");
+    std::vector<std::string> modes = split("span,block,adaptive");
+    std::vector<std::string> resolutions = split("640x480");
+    std::vector<std::string> threads = split("1,0");
+    std::vector<std::string> varyings = split("4");
+    int trials = 10;
+    int warmup = 2;
+    std::string format = "csv";
+    std::string output;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", option.c_str());
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        if (option == "--scenes") scenes = split(value);
+        else if (option == "--modes") modes = split(value);
+        else if (option == "--resolutions") resolutions = split(value);
+        else if (option == "--threads") threads = split(value);
+        else if (option == "--varyings") varyings = split(value);
+        else if (option == "--trials") trials = std::atoi(value.c_str());
+        else if (option == "--warmup") warmup = std::atoi(value.c_str());
+        else if (option == "--format") format = value;
+        else if (option == "--output") output = value;
+        else {
+            fprintf(stderr, "Unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    if (trials <= 0 || warmup < 0 || (format != "csv" && format != "json")) {
+        fprintf(stderr, "Usage: BenchmarkSuite [--scenes list] [--modes list] [--resolutions list] [--threads list]\n"
+            "    [--varyings list] [--trials n] [--warmup n] [--format csv|json] [--output file]\n");
+        return 1;
+    }
+
+    // 0 is the thread count of the default pool, skip duplicates
+    std::vector<int> threadCounts;
+    for (const std::string &item : threads) {
+        int threadCount = std::atoi(item.c_str());
+        if (threadCount <= 0)
+            threadCount = ThreadPool::defaultPool()->threadCount();
+        if (std::find(threadCounts.begin(), threadCounts.end(), threadCount) == threadCounts.end())
+            threadCounts.push_back(threadCount);
+    }
+
+    std::vector<Config> configs;
+    for (const std::string &resolution : resolutions) {
+        Config config;
+        if (sscanf(resolution.c_str(), "%dx%d", &config.width, &config.height) != 2 || config.width <= 0 || config.height <= 0) {
+            fprintf(stderr, "Invalid resolution %s\n", resolution.c_str());
+            return 1;
+        }
+
+        for (const std::string &scene : scenes) {
+            config.scene = scene;
+            for (const std::string &mode : modes) {
+                if (mode == "span") config.mode = RasterMode::Span;
+                else if (mode == "block") config.mode = RasterMode::Block;
+                else if (mode == "adaptive") config.mode = RasterMode::Adaptive;
+                else {
+                    fprintf(stderr, "Unknown raster mode %s\n", mode.c_str());
+                    return 1;
+                }
+
+                for (int threadCount : threadCounts) {
+                    config.threads = threadCount;
+                    for (const std::string &varyingCount : varyings) {
+                        config.varyings = std::atoi(varyingCount.c_str());
+                        configs.push_back(config);
+                    }
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<Texture> texture = createTexture();
+    std::vector<Result> results;
+    Scene scene;
+    int sceneWidth = 0, sceneHeight = 0;
+
+    for (const Config &config : configs) {
+        // Scenes only depend on the resolution, reuse them across the sweep
+        if (scene.name != config.scene || sceneWidth != config.width || sceneHeight != config.height) {
+            scene = Scene();
+            sceneWidth = config.width;
+            sceneHeight = config.height;
+            if (!buildScene(scene, config.scene, config.width, config.height)) {
+                fprintf(stderr, "Unknown scene %s\n", config.scene.c_str());
+                return 1;
+            }
+        }
+
+        Result result;
+        if (!runConfig(result, config, scene, texture.get(), trials, warmup)) {
+            fprintf(stderr, "Unsupported varying count %d\n", config.varyings);
+            return 1;
+        }
+
+        fprintf(stderr, "%-8s %-8s %dx%d threads %d varyings %d: %.3f ms\n", config.scene.c_str(), modeName(config.mode),
+            config.width, config.height, result.config.threads, config.varyings, result.medianMs);
+        results.push_back(result);
+    }
+
+    FILE *file = output.empty() ? stdout : fopen(output.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", output.c_str());
+        return 1;
+    }
+
+    if (format == "json")
+        writeJson(file, results);
+    else
+        writeCsv(file, results);
+
+    if (file != stdout)
+        fclose(file);
+
+    return 0;
+}
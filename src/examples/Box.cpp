@@ -25,7 +25,7 @@ SOFTWARE.
 #include "SDL.h"
 #include "SDL_image.h"
 #include "Renderer.h"
-#include "ObjData.h"
+#include "MeshCache.h"
 #include "vector_math.h"
 #include "Texture.h"
 #include <memory>
@@ -43,36 +43,42 @@ public:
     static const int AVarCount = 0;
     static const int PVarCount = 2;  // UV coordinates
 
-    static SDL_Surface* surface;
-    static std::shared_ptr<Texture> texture;
+    static const int SegmentSize = 4;  // Pixels sharing one texture footprint
 
-    static void drawPixel(const PixelData &p)
+    std::shared_ptr<Texture> texture;
+
+    struct Segment {
+        TextureFootprint footprint;
+    };
+
+    void beginSegment(const PixelData &p, Segment &segment) const
     {
         // Compute texture coordinate derivatives
         float dudx, dudy, dvdx, dvdy;
         p.computePerspectiveDerivatives(*p.equations, 0, dudx, dudy); // U derivatives
         p.computePerspectiveDerivatives(*p.equations, 1, dvdx, dvdy); // V derivatives
 
+        segment.footprint = texture->footprint(dudx, dvdx, dudy, dvdy);
+    }
+
+    void drawPixel(const PixelData &p) const
+    {
         Uint32 sampledColor;
-        texture->sample(p.pvar[0], p.pvar[1], dudx, dvdx, dudy, dvdy, sampledColor);
+        texture->sample(p.pvar[0], p.pvar[1], segment(p).footprint, sampledColor);
 
-        Uint32 *screenBuffer = (Uint32*)((Uint8 *)surface->pixels + (size_t)p.y * (size_t)surface->pitch + (size_t)p.x * 4);
-        *screenBuffer = sampledColor;
+        *(Uint32*)p.color = sampledColor;
     }
 };
 
-SDL_Surface* PixelShader::surface;
-std::shared_ptr<Texture> PixelShader::texture;
-
 class VertexShader : public VertexShaderBase<VertexShader> {
 public:
     static const int AttribCount = 1;
     static const int AVarCount = 0;
     static const int PVarCount = 2;
 
-    static mat4f modelViewProjectionMatrix;
+    mat4f modelViewProjectionMatrix;
 
-    static void processVertex(VertexShaderInput in, VertexShaderOutput *out)
+    void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
     {
         const ObjData::VertexArrayData *data = static_cast<const ObjData::VertexArrayData*>(in[0]);
 
@@ -87,8 +93,6 @@ public:
     }
 };
 
-mat4f VertexShader::modelViewProjectionMatrix;
-
 int main(int argc, char *argv[])
 {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -135,31 +139,38 @@ int main(int argc, char *argv[])
             throw std::runtime_error(std::string("Could not load texture! SDL_image Error: ") + IMG_GetError());
         }
 
-        SDL_Surface *baseTex = SDL_ConvertSurface(tmp, screen->format, 0);
+        SDL_Surface *baseTex = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_ARGB8888, 0);
         SDL_FreeSurface(tmp);
 
         if (!baseTex) {
             throw std::runtime_error(std::string("Could not convert texture surface! SDL Error: ") + SDL_GetError());
         }
 
-        // Create texture with mipmaps
-        PixelShader::texture = std::make_shared<Texture>(baseTex);
-        PixelShader::surface = screen;
+        // Create texture with mipmaps, it keeps its own copy of the pixels
+        PixelShader pixelShader;
+        pixelShader.texture = std::make_shared<Texture>((const uint32_t*)baseTex->pixels, baseTex->w, baseTex->h, baseTex->pitch);
+        SDL_FreeSurface(baseTex);
+
+        VertexShader vertexShader;
+
+        // Uses data/box.obj.swrmesh if it is up to date
+        MeshCache mesh;
+        if (!mesh.load("data/box.obj"))
+            throw std::runtime_error("Could not load data/box.obj");
 
-        std::vector<ObjData::VertexArrayData> vdata;
-        std::vector<int> idata;
-        ObjData::loadFromFile("data/box.obj").toVertexArray(vdata, idata);
+        RenderTarget colorTarget(640, 480, RenderTargetFormat::RGBA8);
 
         Rasterizer r;
         VertexProcessor v(&r);
         
+        r.setRenderTargets(&colorTarget);
         r.setRasterMode(RasterMode::Span);
         r.setScissorRect(0, 0, 640, 480);
-        r.setPixelShader<PixelShader>();
+        r.setPixelShader(&pixelShader);
 
         v.setViewport(0, 0, 640, 480);
         v.setCullMode(CullMode::CW);
-        v.setVertexShader<VertexShader>();
+        v.setVertexShader(&vertexShader);
 
         // Animation and timing variables
         Uint32 lastFrameTime = SDL_GetTicks();
@@ -192,15 +203,16 @@ int main(int argc, char *argv[])
             
             mat4f lookAtMatrix = vmath::lookat_matrix(vec3f(camX, 2.0f, camZ), vec3f(0.0f), vec3f(0.0f, 1.0f, 0.0f));
             mat4f perspectiveMatrix = vmath::perspective_matrix(60.0f, 4.0f / 3.0f, 0.1f, 10.0f);
-            VertexShader::modelViewProjectionMatrix = perspectiveMatrix * lookAtMatrix;
+            vertexShader.modelViewProjectionMatrix = perspectiveMatrix * lookAtMatrix;
 
-            // Clear screen (set to black)
-            SDL_FillRect(screen, NULL, 0);
+            // Clear to black, this only marks the tiles as cleared
+            colorTarget.clear(0);
 
-            // Draw the box
-            v.setVertexAttribPointer(0, sizeof(ObjData::VertexArrayData), &vdata[0]);
-            v.drawElements(DrawMode::Triangle, idata.size(), &idata[0]);
+            // Draw the box, clipping is skipped while it is completely on screen
+            v.setVertexAttribPointer(0, sizeof(ObjData::VertexArrayData), mesh.vertices());
+            mesh.drawElements(v, DrawMode::Triangle, &vertexShader.modelViewProjectionMatrix.elem[0][0]);
 
+            colorTarget.copyToLinear(screen->pixels, screen->pitch);
             SDL_UpdateWindowSurface(window);
             
             // Update FPS counter every second
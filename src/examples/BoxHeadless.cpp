@@ -0,0 +1,217 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Renders the rotating box to image files without a window.
+// Usage: BoxHeadless [frames] [png|ppm|raw] [width height]
+
+#include "Renderer.h"
+#include "ImageWriter.h"
+#include "Texture.h"
+#include "MeshCache.h"
+#include "vector_math.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef vmath::vec3<float> vec3f;
+typedef vmath::vec4<float> vec4f;
+typedef vmath::mat4<float> mat4f;
+
+using namespace swr;
+
+class PixelShader : public PixelShaderBase<PixelShader> {
+public:
+    static const bool InterpolateZ = true;  // Required for the depth test
+    static const bool InterpolateW = true;
+    static const int AVarCount = 0;
+    static const int PVarCount = 2;  // UV coordinates
+    static const bool ColorOutput = true;
+
+    static const int SegmentSize = 4;  // Pixels sharing one texture footprint
+
+    const Texture *texture;
+
+    struct Segment {
+        TextureFootprint footprint;
+    };
+
+    void beginSegment(const PixelData &p, Segment &segment) const
+    {
+        float dudx, dudy, dvdx, dvdy;
+        p.computePerspectiveDerivatives(*p.equations, 0, dudx, dudy);
+        p.computePerspectiveDerivatives(*p.equations, 1, dvdx, dvdy);
+
+        segment.footprint = texture->footprint(dudx, dvdx, dudy, dvdy);
+    }
+
+    uint32_t shadePixel(const PixelData &p) const
+    {
+        uint32_t color;
+        texture->sample(p.pvar[0], p.pvar[1], segment(p).footprint, color);
+        return 0xff000000 | color;
+    }
+};
+
+// Checker pattern in place of box.png, which needs SDL_image to load.
+static std::vector<uint32_t> checkerImage(int size)
+{
+    std::vector<uint32_t> pixels(size * size);
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+            pixels[y * size + x] = (((x * 8 / size) ^ (y * 8 / size)) & 1) ? 0xffc08040 : 0xff604020;
+    return pixels;
+}
+
+class VertexShader : public VertexShaderBase<VertexShader> {
+public:
+    static const int AttribCount = 1;
+    static const int AVarCount = 0;
+    static const int PVarCount = 2;
+
+    mat4f modelViewProjectionMatrix;
+
+    void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
+    {
+        const ObjData::VertexArrayData *data = static_cast<const ObjData::VertexArrayData*>(in[0]);
+
+        vec4f position = modelViewProjectionMatrix * vec4f(data->vertex, 1.0f);
+
+        out->x = position.x;
+        out->y = position.y;
+        out->z = position.z;
+        out->w = position.w;
+        out->pvar[0] = data->texcoord.x;
+        out->pvar[1] = data->texcoord.y;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 60;
+    std::string extension = argc > 2 ? argv[2] : "png";
+    int width = argc > 4 ? std::atoi(argv[3]) : 640;
+    int height = argc > 4 ? std::atoi(argv[4]) : 480;
+
+    ImageFormat format;
+    if (extension == "png")
+        format = ImageFormat::PNG;
+    else if (extension == "ppm")
+        format = ImageFormat::PPM;
+    else if (extension == "raw")
+        format = ImageFormat::Raw;
+    else {
+        fprintf(stderr, "Unknown image format: %s\n", extension.c_str());
+        return 1;
+    }
+
+    if (frames < 0 || width <= 0 || height <= 0) {
+        fprintf(stderr, "Usage: BoxHeadless [frames] [png|ppm|raw] [width height]\n");
+        return 1;
+    }
+
+    try {
+        // Uses data/box.obj.swrmesh if it is up to date
+        MeshCache mesh;
+        if (!mesh.load("data/box.obj"))
+            throw std::runtime_error("Could not load data/box.obj");
+
+        RenderTarget colorTarget(width, height, RenderTargetFormat::RGBA8);
+        RenderTarget depthTarget(width, height, RenderTargetFormat::D32F);
+
+        std::vector<uint32_t> checker = checkerImage(256);
+        Texture texture(checker.data(), 256, 256, 256 * 4);
+
+        PixelShader pixelShader;
+        pixelShader.texture = &texture;
+        VertexShader vertexShader;
+
+        Rasterizer r;
+        VertexProcessor v(&r);
+
+        DepthState depthState;
+        depthState.depthTest = true;
+
+        r.setRenderTargets(&colorTarget, &depthTarget);
+        r.setDepthState(depthState);
+        r.setRasterMode(RasterMode::Span);
+        r.setScissorRect(0, 0, width, height);
+        r.setPixelShader(&pixelShader);
+
+        v.setViewport(0, 0, width, height);
+        v.setCullMode(CullMode::CW);
+        v.setVertexShader(&vertexShader);
+        v.setVertexAttribPointer(0, sizeof(ObjData::VertexArrayData), mesh.vertices());
+
+        mat4f perspectiveMatrix = vmath::perspective_matrix(60.0f, (float)width / height, 0.1f, 10.0f);
+
+        // Files are encoded and written on the writer thread
+        AsyncImageWriter writer;
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int frame = 0; frame < frames; ++frame) {
+            // Fixed time step, so the output does not depend on the frame rate
+            float angle = frame * (1.0f / 60.0f) * 0.5f;
+            float camX = 5.0f * cos(angle);
+            float camZ = 5.0f * sin(angle);
+
+            mat4f lookAtMatrix = vmath::lookat_matrix(vec3f(camX, 2.0f, camZ), vec3f(0.0f), vec3f(0.0f, 1.0f, 0.0f));
+            vertexShader.modelViewProjectionMatrix = perspectiveMatrix * lookAtMatrix;
+
+            colorTarget.clear(0xff000000);
+            depthTarget.clearDepth(1.0f);
+
+            // Skips clipping while the box is completely on screen
+            mesh.drawElements(v, DrawMode::Triangle, &vertexShader.modelViewProjectionMatrix.elem[0][0]);
+
+            char path[64];
+            snprintf(path, sizeof(path), "box_%04d.%s", frame, extension.c_str());
+            writer.write(colorTarget, path, format);
+        }
+
+        auto rendered = std::chrono::high_resolution_clock::now();
+        writer.flush();
+        auto written = std::chrono::high_resolution_clock::now();
+
+        printf("Rendered %d frames in %d ms, waited %d ms for the writer\n", frames,
+            (int)std::chrono::duration_cast<std::chrono::milliseconds>(rendered - start).count(),
+            (int)std::chrono::duration_cast<std::chrono::milliseconds>(written - rendered).count());
+
+        if (writer.failedWrites() > 0) {
+            fprintf(stderr, "Could not write %d images\n", (int)writer.failedWrites());
+            return 1;
+        }
+
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
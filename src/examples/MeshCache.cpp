@@ -0,0 +1,397 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+	size_t alignUp(size_t offset)
+	{
+		return (offset + MeshCache::BlockAlignment - 1) & ~(MeshCache::BlockAlignment - 1);
+	}
+
+	bool sourceInfo(const char *filename, uint64_t &size, uint64_t &time)
+	{
+		struct stat st;
+		if (!filename || stat(filename, &st) != 0)
+			return false;
+
+		size = static_cast<uint64_t>(st.st_size);
+		time = static_cast<uint64_t>(st.st_mtime);
+		return true;
+	}
+
+	// Whether size bytes at offset are inside the file, without overflowing
+	bool fitsInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+
+	template <class Index>
+	bool indicesInRange(const void *indices, size_t count, uint32_t vertexCount)
+	{
+		const Index *p = static_cast<const Index*>(indices);
+		for (size_t i = 0; i < count; ++i) {
+			if (static_cast<uint32_t>(p[i]) >= vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	uint16_t quantizeUnorm(float value, float min, float max)
+	{
+		float t = max > min ? (value - min) / (max - min) : 0.0f;
+		return static_cast<uint16_t>(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	}
+
+	int8_t quantizeSnorm(float value)
+	{
+		return static_cast<int8_t>(std::floor(std::min(std::max(value, -1.0f), 1.0f) * 127.0f + 0.5f));
+	}
+
+	bool writeFile(const char *filename, const MeshCache::Header &header, const vector<unsigned char> &data)
+	{
+		FILE *file = fopen(filename, "wb");
+		if (!file)
+			return false;
+
+		static const char zeros[MeshCache::BlockAlignment] = {0};
+		size_t padding = header.vertexOffset - sizeof(header);
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(zeros, 1, padding, file) == padding
+			&& (data.empty() || fwrite(&data[0], 1, data.size(), file) == data.size());
+
+		return fclose(file) == 0 && ok;
+	}
+}
+
+const uint32_t MeshCache::Magic;
+const uint32_t MeshCache::Version;
+const size_t MeshCache::BlockAlignment;
+
+MeshCache::MeshCache()
+	: m_header(nullptr)
+	, m_open(false)
+	, m_vertices(nullptr)
+	, m_vertexCount(0)
+	, m_indices(nullptr)
+	, m_indexCount(0)
+	, m_indexSize(4)
+	, m_quantized(nullptr)
+{
+	std::fill(m_positionMin, m_positionMin + 3, 0.0f);
+	std::fill(m_positionMax, m_positionMax + 3, 0.0f);
+	std::fill(m_texcoordMin, m_texcoordMin + 2, 0.0f);
+	std::fill(m_texcoordMax, m_texcoordMax + 2, 0.0f);
+}
+
+uint64_t MeshCache::checksum(const void *data, size_t size)
+{
+	const uint64_t prime = 0x9e3779b97f4a7c15ull;
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+
+	uint64_t h = size * prime;
+	for (; size >= 8; size -= 8, p += 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		word *= 0xc2b2ae3d27d4eb4full;
+		word ^= word >> 31;
+		h = (h ^ word) * prime;
+		h ^= h >> 29;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, p, size);
+	h = (h ^ tail) * prime;
+	return h ^ (h >> 32);
+}
+
+bool MeshCache::write(const char *filename, const vector<ObjData::VertexArrayData> &vdata,
+	const vector<int> &idata, bool quantize, const char *sourceFilename)
+{
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.magic = Magic;
+	header.version = Version;
+	header.vertexSize = sizeof(ObjData::VertexArrayData);
+	header.flags = quantize ? QuantizedStream : 0;
+	header.vertexCount = static_cast<uint32_t>(vdata.size());
+	header.indexCount = static_cast<uint32_t>(idata.size());
+	header.indexSize = vdata.size() <= 0x10000 ? 2 : 4;
+	sourceInfo(sourceFilename, header.sourceSize, header.sourceTime);
+
+	for (int i = 0; i < 3; ++i) {
+		header.positionMin[i] = vdata.empty() ? 0.0f : vdata[0].vertex[i];
+		header.positionMax[i] = header.positionMin[i];
+	}
+	for (int i = 0; i < 2; ++i) {
+		header.texcoordMin[i] = vdata.empty() ? 0.0f : vdata[0].texcoord[i];
+		header.texcoordMax[i] = header.texcoordMin[i];
+	}
+	for (size_t v = 0; v < vdata.size(); ++v) {
+		for (int i = 0; i < 3; ++i) {
+			header.positionMin[i] = std::min(header.positionMin[i], vdata[v].vertex[i]);
+			header.positionMax[i] = std::max(header.positionMax[i], vdata[v].vertex[i]);
+		}
+		for (int i = 0; i < 2; ++i) {
+			header.texcoordMin[i] = std::min(header.texcoordMin[i], vdata[v].texcoord[i]);
+			header.texcoordMax[i] = std::max(header.texcoordMax[i], vdata[v].texcoord[i]);
+		}
+	}
+
+	vector<uint16_t> indices16;
+	if (header.indexSize == 2)
+		indices16.assign(idata.begin(), idata.end());
+
+	vector<QuantizedVertex> quantized;
+	if (quantize) {
+		quantized.resize(vdata.size());
+		for (size_t v = 0; v < vdata.size(); ++v) {
+			QuantizedVertex &q = quantized[v];
+			memset(&q, 0, sizeof(q));
+			for (int i = 0; i < 3; ++i) {
+				q.position[i] = quantizeUnorm(vdata[v].vertex[i], header.positionMin[i], header.positionMax[i]);
+				q.normal[i] = quantizeSnorm(vdata[v].normal[i]);
+			}
+			for (int i = 0; i < 2; ++i)
+				q.texcoord[i] = quantizeUnorm(vdata[v].texcoord[i], header.texcoordMin[i], header.texcoordMax[i]);
+		}
+	}
+
+	vector<const void*> blocks;
+	vector<size_t> offsets, sizes;
+	blocks.push_back(vdata.empty() ? nullptr : &vdata[0]);
+	sizes.push_back(vdata.size() * sizeof(ObjData::VertexArrayData));
+	blocks.push_back(header.indexSize == 2 ? (indices16.empty() ? nullptr : (const void*)&indices16[0]) : (idata.empty() ? nullptr : (const void*)&idata[0]));
+	sizes.push_back(idata.size() * header.indexSize);
+	if (quantize) {
+		blocks.push_back(quantized.empty() ? nullptr : &quantized[0]);
+		sizes.push_back(quantized.size() * sizeof(QuantizedVertex));
+	}
+
+	size_t offset = sizeof(Header);
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		offset = alignUp(offset);
+		offsets.push_back(offset);
+		offset += sizes[i];
+	}
+
+	header.vertexOffset = offsets[0];
+	header.indexOffset = offsets[1];
+	header.quantizedOffset = quantize ? offsets[2] : 0;
+	header.dataSize = offset - offsets[0];
+
+	// The checksum covers the padding between the blocks, which is zero
+	vector<unsigned char> data(header.dataSize, 0);
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		if (sizes[i])
+			memcpy(&data[offsets[i] - offsets[0]], blocks[i], sizes[i]);
+	}
+	header.checksum = checksum(data.empty() ? nullptr : &data[0], data.size());
+
+	string temporary = string(filename) + ".tmp";
+	if (!writeFile(temporary.c_str(), header, data)) {
+		remove(temporary.c_str());
+		return false;
+	}
+
+	// rename does not replace existing files on Windows
+	remove(filename);
+	if (rename(temporary.c_str(), filename) != 0) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::open(const char *filename, const char *sourceFilename)
+{
+	close();
+
+	if (!m_file.open(filename) || m_file.size() < sizeof(Header))
+		return false;
+
+	const Header *header = reinterpret_cast<const Header*>(m_file.data());
+	const char *data = m_file.data();
+	uint64_t fileSize = m_file.size();
+
+	bool valid = header->magic == Magic && header->version == Version
+		&& header->vertexSize == sizeof(ObjData::VertexArrayData)
+		&& (header->indexSize == 2 || header->indexSize == 4)
+		&& header->vertexOffset % BlockAlignment == 0
+		&& header->indexOffset % BlockAlignment == 0
+		&& header->quantizedOffset % BlockAlignment == 0
+		&& header->vertexOffset >= sizeof(Header)
+		&& header->vertexOffset <= fileSize
+		&& header->dataSize == fileSize - header->vertexOffset
+		&& fitsInFile(header->vertexOffset, (uint64_t)header->vertexCount * sizeof(ObjData::VertexArrayData), fileSize)
+		&& fitsInFile(header->indexOffset, (uint64_t)header->indexCount * header->indexSize, fileSize);
+
+	if (valid && (header->flags & QuantizedStream))
+		valid = fitsInFile(header->quantizedOffset, (uint64_t)header->vertexCount * sizeof(QuantizedVertex), fileSize);
+
+	if (valid && sourceFilename) {
+		uint64_t size, time;
+		valid = sourceInfo(sourceFilename, size, time) && size == header->sourceSize && time == header->sourceTime;
+	}
+
+	valid = valid && checksum(data + header->vertexOffset, header->dataSize) == header->checksum;
+
+	// A corrupt cache must not make drawElements() read past the vertices
+	if (valid) {
+		const void *indices = data + header->indexOffset;
+		valid = header->indexSize == 2
+			? indicesInRange<uint16_t>(indices, header->indexCount, header->vertexCount)
+			: indicesInRange<uint32_t>(indices, header->indexCount, header->vertexCount);
+	}
+
+	if (!valid) {
+		m_file.close();
+		return false;
+	}
+
+	m_header = header;
+	m_open = true;
+	m_vertices = reinterpret_cast<const ObjData::VertexArrayData*>(data + header->vertexOffset);
+	m_vertexCount = header->vertexCount;
+	m_indices = data + header->indexOffset;
+	m_indexCount = header->indexCount;
+	m_indexSize = header->indexSize;
+	m_quantized = header->flags & QuantizedStream ? reinterpret_cast<const QuantizedVertex*>(data + header->quantizedOffset) : nullptr;
+	setBounds(*header);
+	return true;
+}
+
+bool MeshCache::load(const char *objFilename, bool quantize)
+{
+	string cacheFilename = string(objFilename) + ".swrmesh";
+	if (open(cacheFilename.c_str(), objFilename) && (!quantize || m_quantized))
+		return true;
+
+	close();
+
+	uint64_t size, time;
+	if (!sourceInfo(objFilename, size, time))
+		return false;
+
+	vector<ObjData::VertexArrayData> vdata;
+	vector<int> idata;
+	ObjData::loadFromFile(objFilename).toVertexArray(vdata, idata);
+	swr::optimizeMesh(vdata, idata, &ObjData::VertexArrayData::vertex);
+
+	if (write(cacheFilename.c_str(), vdata, idata, quantize, objFilename) && open(cacheFilename.c_str(), objFilename))
+		return true;
+
+	// Use the arrays directly if the cache is not writable
+	for (size_t v = 0; v < vdata.size(); ++v) {
+		for (int i = 0; i < 3; ++i) {
+			m_positionMin[i] = v ? std::min(m_positionMin[i], vdata[v].vertex[i]) : vdata[v].vertex[i];
+			m_positionMax[i] = v ? std::max(m_positionMax[i], vdata[v].vertex[i]) : vdata[v].vertex[i];
+		}
+	}
+
+	m_vdata.swap(vdata);
+	m_idata.swap(idata);
+	m_open = true;
+	m_vertices = m_vdata.empty() ? nullptr : &m_vdata[0];
+	m_vertexCount = m_vdata.size();
+	m_indices = m_idata.empty() ? nullptr : &m_idata[0];
+	m_indexCount = m_idata.size();
+	m_indexSize = 4;
+	return true;
+}
+
+void MeshCache::close()
+{
+	m_file.close();
+	m_header = nullptr;
+	m_open = false;
+	m_vertices = nullptr;
+	m_vertexCount = 0;
+	m_indices = nullptr;
+	m_indexCount = 0;
+	m_indexSize = 4;
+	m_quantized = nullptr;
+	vector<ObjData::VertexArrayData>().swap(m_vdata);
+	vector<int>().swap(m_idata);
+}
+
+void MeshCache::setBounds(const Header &header)
+{
+	std::copy(header.positionMin, header.positionMin + 3, m_positionMin);
+	std::copy(header.positionMax, header.positionMax + 3, m_positionMax);
+	std::copy(header.texcoordMin, header.texcoordMin + 2, m_texcoordMin);
+	std::copy(header.texcoordMax, header.texcoordMax + 2, m_texcoordMax);
+}
+
+ObjData::VertexArrayData MeshCache::dequantize(const QuantizedVertex &q) const
+{
+	ObjData::VertexArrayData v;
+	for (int i = 0; i < 3; ++i) {
+		v.vertex[i] = m_positionMin[i] + (m_positionMax[i] - m_positionMin[i]) * (q.position[i] / 65535.0f);
+		v.normal[i] = std::max(q.normal[i] / 127.0f, -1.0f);
+	}
+	for (int i = 0; i < 2; ++i)
+		v.texcoord[i] = m_texcoordMin[i] + (m_texcoordMax[i] - m_texcoordMin[i]) * (q.texcoord[i] / 65535.0f);
+	return v;
+}
+
+swr::BoundingBox MeshCache::bounds() const
+{
+	swr::BoundingBox box;
+	std::copy(m_positionMin, m_positionMin + 3, box.min);
+	std::copy(m_positionMax, m_positionMax + 3, box.max);
+	return box;
+}
+
+void MeshCache::drawElements(const swr::VertexProcessor &processor, swr::DrawMode mode, const float *clipMatrix) const
+{
+	if (m_indexCount == 0)
+		return;
+
+	if (m_indexSize == 2)
+		processor.drawElements(mode, m_indexCount, indices16(), bounds(), clipMatrix);
+	else
+		processor.drawElements(mode, m_indexCount, indices32(), bounds(), clipMatrix);
+}
+
+void MeshCache::drawElements(const swr::VertexProcessor &processor, swr::DrawMode mode) const
+{
+	if (m_indexCount == 0)
+		return;
+
+	if (m_indexSize == 2)
+		processor.drawElements(mode, m_indexCount, indices16());
+	else
+		processor.drawElements(mode, m_indexCount, indices32());
+}
@@ -0,0 +1,165 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "ObjData.h"
+#include "MappedFile.h"
+#include "VertexProcessor.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary file with the vertex and index arrays of a mesh, ready to draw.
+//
+// The file is a Header followed by blocks aligned to BlockAlignment bytes:
+// the ObjData::VertexArrayData array, the 16 or 32 bit indices and an
+// optional array of QuantizedVertex. It is memory mapped, so vertices()
+// can be passed to setVertexAttribPointer() without copying or parsing.
+// Integers and floats are stored in the byte order of the machine that
+// wrote the file, other machines reject it.
+class MeshCache {
+public:
+	static const uint32_t Magic = 0x4d525753;  // "SWRM"
+	static const uint32_t Version = 1;
+	static const size_t BlockAlignment = 64;
+
+	enum Flags {
+		QuantizedStream = 1
+	};
+
+	// 16 byte vertex with the position and texcoord as 16 bit unorm over
+	// the bounds of the mesh and the normal as 8 bit snorm.
+	struct QuantizedVertex {
+		uint16_t position[3];
+		uint16_t texcoord[2];
+		int8_t normal[3];
+		uint8_t padding[3];
+	};
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexSize;     // sizeof(ObjData::VertexArrayData)
+		uint32_t flags;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t indexSize;      // 2 or 4
+		uint32_t reserved;
+		uint64_t sourceSize;     // size and modification time of the OBJ file
+		uint64_t sourceTime;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t quantizedOffset;
+		uint64_t dataSize;       // bytes from vertexOffset to the end of the file
+		uint64_t checksum;       // checksum() of these bytes
+		float positionMin[3];
+		float positionMax[3];
+		float texcoordMin[2];
+		float texcoordMax[2];
+	};
+
+	MeshCache();
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	// Write vertex and index arrays to a cache file. 16 bit indices are
+	// used if there are at most 65536 vertices. The file is written under
+	// a temporary name and renamed, so readers never see a partial file.
+	static bool write(const char *filename, const std::vector<ObjData::VertexArrayData> &vdata,
+		const std::vector<int> &idata, bool quantize = false, const char *sourceFilename = nullptr);
+
+	// Map a cache file and check its header, checksum and that all indices
+	// refer to vertices. If sourceFilename is given, the size and
+	// modification time of the source must match.
+	bool open(const char *filename, const char *sourceFilename = nullptr);
+
+	// Load an OBJ file through its cache objFilename + ".swrmesh". A
+	// missing or stale cache is rebuilt from the OBJ file, with triangles
+	// and vertices reordered for the vertex cache and for less overdraw by
+	// swr::optimizeMesh(). If the cache cannot be written, the converted
+	// arrays are kept in memory.
+	bool load(const char *objFilename, bool quantize = false);
+
+	void close();
+
+	bool isOpen() const { return m_open; }
+
+	// Whether the data comes from a mapped cache file.
+	bool isMapped() const { return m_header != nullptr; }
+
+	const ObjData::VertexArrayData *vertices() const { return m_vertices; }
+	size_t vertexCount() const { return m_vertexCount; }
+
+	size_t indexCount() const { return m_indexCount; }
+	size_t indexSize() const { return m_indexSize; }
+
+	// Index arrays, nullptr if the indices have the other size.
+	const uint16_t *indices16() const { return m_indexSize == 2 ? static_cast<const uint16_t*>(m_indices) : nullptr; }
+	const int *indices32() const { return m_indexSize == 4 ? static_cast<const int*>(m_indices) : nullptr; }
+
+	// Quantized vertices, nullptr if the file has none or is not mapped.
+	const QuantizedVertex *quantizedVertices() const { return m_quantized; }
+	ObjData::VertexArrayData dequantize(const QuantizedVertex &q) const;
+
+	// Object space bounds of all vertices.
+	swr::BoundingBox bounds() const;
+
+	// Draw the indexed vertices with the processor. The vertex attrib
+	// pointers must already be set.
+	void drawElements(const swr::VertexProcessor &processor, swr::DrawMode mode) const;
+
+	// Draw within bounds(), which skips meshes outside the frustum and
+	// clipping for meshes inside it. clipMatrix is the object to clip
+	// space transform of the vertex shader, see swr::Frustum.
+	void drawElements(const swr::VertexProcessor &processor, swr::DrawMode mode, const float *clipMatrix) const;
+
+	// Checksum of the data blocks, 64 bits processed per step.
+	static uint64_t checksum(const void *data, size_t size);
+
+private:
+	void setBounds(const Header &header);
+
+	MappedFile m_file;
+	const Header *m_header;
+	bool m_open;
+
+	const ObjData::VertexArrayData *m_vertices;
+	size_t m_vertexCount;
+	const void *m_indices;
+	size_t m_indexCount;
+	size_t m_indexSize;
+	const QuantizedVertex *m_quantized;
+
+	float m_positionMin[3];
+	float m_positionMax[3];
+	float m_texcoordMin[2];
+	float m_texcoordMax[2];
+
+	// Converted arrays if the cache could not be written
+	std::vector<ObjData::VertexArrayData> m_vdata;
+	std::vector<int> m_idata;
+};
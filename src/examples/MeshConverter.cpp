@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Converts OBJ files to mesh cache files, see MeshCache.
+int main(int argc, char *argv[])
+{
+	const char *input = nullptr;
+	std::string output;
+	bool quantize = false;
+	bool optimize = true;
+	bool overdraw = true;
+	bool stats = false;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--quantize") == 0)
+			quantize = true;
+		else if (strcmp(argv[i], "--keep-order") == 0)
+			optimize = false;
+		else if (strcmp(argv[i], "--no-overdraw") == 0)
+			overdraw = false;
+		else if (strcmp(argv[i], "--stats") == 0)
+			stats = true;
+		else if (!input)
+			input = argv[i];
+		else if (output.empty())
+			output = argv[i];
+		else
+			input = nullptr, i = argc;
+	}
+
+	if (!input) {
+		fprintf(stderr, "Usage: MeshConverter input.obj [output] [--quantize] [--keep-order] [--no-overdraw] [--stats]\n"
+			"The output defaults to input.obj.swrmesh, which MeshCache::load() picks up.\n"
+			"Triangles and vertices are reordered for the vertex cache and for less overdraw.\n"
+			"--keep-order skips this, --no-overdraw only optimizes for the vertex cache.\n"
+			"--stats also measures the overdraw, which takes long for large meshes.\n");
+		return 1;
+	}
+
+	if (output.empty())
+		output = std::string(input) + ".swrmesh";
+
+	auto start = std::chrono::steady_clock::now();
+
+	// ObjData reads a file it cannot open as empty, check it here so no
+	// empty cache is written
+	MappedFile source;
+	if (!source.open(input)) {
+		fprintf(stderr, "Could not open %s\n", input);
+		return 1;
+	}
+
+	std::vector<ObjData::VertexArrayData> vdata;
+	std::vector<int> idata;
+	ObjData::loadFromMemory(source.data(), source.size()).toVertexArray(vdata, idata);
+	source.close();
+
+	auto converted = std::chrono::steady_clock::now();
+
+	if (optimize && !idata.empty()) {
+		const size_t stride = sizeof(ObjData::VertexArrayData);
+		swr::VertexCacheStatistics before = swr::analyzeVertexCache(&idata[0], idata.size(), vdata.size());
+		swr::OverdrawStatistics overdrawBefore = {};
+		if (stats)
+			overdrawBefore = swr::analyzeOverdraw(&idata[0], idata.size(), &vdata[0].vertex.x, vdata.size(), stride);
+
+		auto optimizing = std::chrono::steady_clock::now();
+		if (overdraw)
+			swr::optimizeMesh(vdata, idata, &ObjData::VertexArrayData::vertex);
+		else
+			swr::optimizeMesh(vdata, idata);
+		auto optimized = std::chrono::steady_clock::now();
+
+		swr::VertexCacheStatistics after = swr::analyzeVertexCache(&idata[0], idata.size(), vdata.size());
+		printf("Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+		printf("Optimization %.1f ms\n", std::chrono::duration<double, std::milli>(optimized - optimizing).count());
+
+		if (stats) {
+			swr::OverdrawStatistics overdrawAfter = swr::analyzeOverdraw(&idata[0], idata.size(), &vdata[0].vertex.x, vdata.size(), stride);
+			printf("Overdraw: %.3f -> %.3f\n", overdrawBefore.overdraw, overdrawAfter.overdraw);
+		}
+	}
+
+	if (!MeshCache::write(output.c_str(), vdata, idata, quantize, input)) {
+		fprintf(stderr, "Could not write %s\n", output.c_str());
+		return 1;
+	}
+
+	// Check what was written
+	MeshCache mesh;
+	auto opening = std::chrono::steady_clock::now();
+	if (!mesh.open(output.c_str(), input)) {
+		fprintf(stderr, "Could not read back %s\n", output.c_str());
+		return 1;
+	}
+	auto opened = std::chrono::steady_clock::now();
+
+	printf("%s: %zu vertices, %zu %d bit indices%s\n", output.c_str(), mesh.vertexCount(), mesh.indexCount(),
+		(int)mesh.indexSize() * 8, mesh.quantizedVertices() ? ", quantized stream" : "");
+	printf("OBJ load and conversion %.1f ms, cache open %.1f ms\n",
+		std::chrono::duration<double, std::milli>(converted - start).count(),
+		std::chrono::duration<double, std::milli>(opened - opening).count());
+	return 0;
+}
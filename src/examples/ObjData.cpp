@@ -23,178 +23,680 @@ SOFTWARE.
 */
 
 #include "ObjData.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
-#include <fstream>
-#include <string>
-#include <sstream>
-
-#include <iostream>
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 
 using namespace std;
 
 typedef vmath::vec3<float> vec3f;
 typedef vmath::vec2<float> vec2f;
 
-// string is supposed to be in the form <vertex_index>/<texture_index>/<normal_index>, 
-void getIndicesFromString(string str, unsigned &vi, unsigned &ni, unsigned &ti)
-{
-	string v;
-	string t;
-	string n;
-
-	string *tmp[3] = {&v, &t, &n};
-	
-	int tidx = 0;
-	string *target = tmp[0];
-	
-	for (size_t i = 0; i < str.size(); ++i) {
-		if (str[i] == '/') target = tmp[++tidx];
-		else *target += str[i];
-	}
-
-	istringstream iss1(v);
-	vi = 0;
-	iss1 >> vi;
-
-	istringstream iss2(t);
-	ti = 0;
-	iss2 >> ti;
-
-	istringstream iss3(n);
-	ni = 0;
-	iss3 >> ni;
-}
+namespace {
+	// Chunks are split at line boundaries and parsed independently.
+	const size_t MinChunkSize = 1 << 20;
 
-ObjData ObjData::loadFromFile(const char *filename)
-{
-	ObjData result;
-	result.vertices.push_back(vec3f(0.0f));
-	result.normals.push_back(vec3f(0.0f));
-	result.texcoords.push_back(vec2f(0.0));
-
-	ifstream in(filename, ios::in);
-	while (in) {
-		string line;
-		getline(in, line);
-		istringstream iss;
-		iss.str(line);
-		string cmd;
-		iss >> cmd;
-		
-		if (cmd[0] == '#') continue;
-		else if (cmd == "v") {
-			vec3f v;
-			iss >> v.x >> v.y >> v.z;
-			result.vertices.push_back(v);
-		} else if (cmd == "vn") {
-			vec3f v;
-			iss >> v.x >> v.y >> v.z;
-			result.normals.push_back(v);
-		} else if (cmd == "vt") {
-			vec2f t;
-			iss >> t.x >> t.y;
-			result.texcoords.push_back(t);
-		} else if (cmd == "f") {
-			result.faces.push_back(ObjData::Face());
-			ObjData::Face &face = result.faces.back();
-			
-			while (iss) {
-				string word;
-				iss >> word;
-
-				if (word == "") continue;
-				
-				ObjData::VertexRef vr;
-				getIndicesFromString(word, vr.vertexIndex, vr.normalIndex, vr.texcoordIndex);
-
-				face.push_back(vr);
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool isDigit(char c)
+	{
+		return static_cast<unsigned>(c - '0') < 10;
+	}
+
+	inline const char *skipSpace(const char *p, const char *end)
+	{
+		while (p < end && isSpace(*p)) ++p;
+		return p;
+	}
+
+	inline const char *skipWord(const char *p, const char *end)
+	{
+		while (p < end && !isSpace(*p)) ++p;
+		return p;
+	}
+
+	// Decimal integer with optional sign. Returns false if there are no digits.
+	inline bool parseInt(const char *&p, const char *end, long long &value)
+	{
+		const char *s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+
+		if (s == end || !isDigit(*s)) return false;
+
+		// Saturates instead of overflowing
+		long long result = 0;
+		for (; s < end && isDigit(*s); ++s)
+			result = std::min(result * 10 + (*s - '0'), 1LL << 40);
+
+		value = negative ? -result : result;
+		p = s;
+		return true;
+	}
+
+	// Anything not covered by parseFloat(), such as nan and inf.
+	bool parseFloatSlow(const char *&p, const char *end, float &value)
+	{
+		char buffer[64];
+		size_t length = std::min(static_cast<size_t>(skipWord(p, end) - p), sizeof(buffer) - 1);
+		memcpy(buffer, p, length);
+		buffer[length] = 0;
+
+		char *parsed;
+		value = strtof(buffer, &parsed);
+		if (parsed == buffer) return false;
+
+		p += parsed - buffer;
+		return true;
+	}
+
+	// Decimal float with optional sign, fraction and exponent. The first 19
+	// significant digits are used, which is plenty for float.
+	inline bool parseFloat(const char *&p, const char *end, float &value)
+	{
+		static const double powers[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char *s = p;
+		bool negative = false;
+		if (s < end && (*s == '-' || *s == '+')) negative = *s++ == '-';
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool any = false;
+
+		for (; s < end && isDigit(*s); ++s) {
+			any = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*s - '0');
+				digits += mantissa != 0;
+			} else {
+				++exponent;
+			}
+		}
+
+		if (s < end && *s == '.') {
+			for (++s; s < end && isDigit(*s); ++s) {
+				any = true;
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*s - '0');
+					digits += mantissa != 0;
+					--exponent;
+				}
+			}
+		}
+
+		if (!any) return parseFloatSlow(p, end, value);
+
+		if (s < end && (*s == 'e' || *s == 'E')) {
+			const char *e = s + 1;
+			long long e10;
+			if (parseInt(e, end, e10)) {
+				exponent += static_cast<int>(std::max(std::min(e10, 1000LL), -1000LL));
+				s = e;
 			}
 		}
+
+		double result = static_cast<double>(mantissa);
+		if (mantissa == 0)
+			result = 0.0;
+		else if (exponent >= 0 && exponent <= 22)
+			result *= powers[exponent];
+		else if (exponent < 0 && exponent >= -22)
+			result /= powers[-exponent];
+		else
+			result *= std::pow(10.0, exponent);
+
+		value = static_cast<float>(negative ? -result : result);
+		p = s;
+		return true;
 	}
 
-	return result;
-}
+	// Faces and the position of o, g and usemtl statements in a chunk.
+	// Negative indices depend on the element counts of the previous chunks
+	// and are resolved during the merge.
+	struct Chunk {
+		enum {
+			VertexBit = 1,
+			NormalBit = 2,
+			TexcoordBit = 4,
+			ObjectBit = 1,
+			GroupBit = 2,
+			MaterialBit = 4
+		};
+
+		struct GroupStart {
+			std::string object;
+			std::string group;
+			std::string material;
+			unsigned knownMask;  // names set inside this chunk
+			unsigned firstFace;
+		};
+
+		struct RelativeRef {
+			unsigned ref;
+			unsigned mask;  // fields relative to the start of the chunk
+		};
+
+		vector<vec3f> vertices;
+		vector<vec3f> normals;
+		vector<vec2f> texcoords;
+		vector<ObjData::VertexRef> refs;
+		vector<ObjData::Face> faces;
+		vector<GroupStart> groups;
+		vector<RelativeRef> relativeRefs;
+
+		// Chunk local name state
+		std::string object;
+		std::string group;
+		std::string material;
+		unsigned knownMask;
+
+		Chunk() : knownMask(0) {}
+
+		void parse(const char *p, const char *end)
+		{
+			while (p < end) {
+				const char *eol = static_cast<const char*>(memchr(p, '\n', end - p));
+				if (!eol) eol = end;
+
+				parseLine(skipSpace(p, eol), eol);
+				p = eol + 1;
+			}
+		}
+
+		void parseLine(const char *p, const char *end)
+		{
+			if (end - p < 2) return;
+
+			// Commands are followed by a space, which rules out longer keywords
+			char c0 = p[0];
+			char c1 = p[1];
+			if (c0 == 'v') {
+				if (isSpace(c1)) {
+					vec3f v(0.0f);
+					parseFloats(p + 2, end, &v.x, 3);
+					vertices.push_back(v);
+				} else if (c1 == 'n' && end - p > 2 && isSpace(p[2])) {
+					vec3f n(0.0f);
+					parseFloats(p + 3, end, &n.x, 3);
+					normals.push_back(n);
+				} else if (c1 == 't' && end - p > 2 && isSpace(p[2])) {
+					vec2f t(0.0f);
+					parseFloats(p + 3, end, &t.x, 2);
+					texcoords.push_back(t);
+				}
+			} else if (c0 == 'f' && isSpace(c1)) {
+				parseFace(p + 2, end);
+			} else if ((c0 == 'o' || c0 == 'g') && isSpace(c1)) {
+				setName(c0 == 'o' ? ObjectBit : GroupBit, p + 2, end);
+			} else if (c0 == 'u' && end - p > 6 && memcmp(p, "usemtl", 6) == 0 && isSpace(p[6])) {
+				setName(MaterialBit, p + 7, end);
+			}
+		}
+
+		static void parseFloats(const char *p, const char *end, float *values, int count)
+		{
+			for (int i = 0; i < count; ++i) {
+				p = skipSpace(p, end);
+				if (!parseFloat(p, end, values[i])) return;
+			}
+		}
 
-namespace internal {
-	struct VertexRefCompare {
-		bool operator () (const ObjData::VertexRef &v1, const ObjData::VertexRef &v2) const
+		void parseFace(const char *p, const char *end)
 		{
-			if (v1.vertexIndex < v2.vertexIndex) return true;
-			else if (v1.vertexIndex > v2.vertexIndex) return false;
-			else {
-				if (v1.normalIndex < v2.normalIndex) return true;
-				else if (v1.normalIndex > v2.normalIndex) return false;
-				else {
-					if (v1.texcoordIndex < v2.texcoordIndex) return true;
-					else return false;
+			ObjData::Face face;
+			face.firstRef = static_cast<unsigned>(refs.size());
+
+			for (p = skipSpace(p, end); p < end; p = skipSpace(p, end)) {
+				ObjData::VertexRef ref = {0, 0, 0};
+				unsigned relativeMask = 0;
+
+				if (!parseIndex(p, end, vertices.size(), VertexBit, ref.vertexIndex, relativeMask)) {
+					p = skipWord(p, end);
+					continue;
 				}
+
+				if (p < end && *p == '/') {
+					++p;
+					if (p < end && *p != '/')
+						parseIndex(p, end, texcoords.size(), TexcoordBit, ref.texcoordIndex, relativeMask);
+					if (p < end && *p == '/') {
+						++p;
+						parseIndex(p, end, normals.size(), NormalBit, ref.normalIndex, relativeMask);
+					}
+				}
+
+				if (relativeMask) {
+					RelativeRef relative = {static_cast<unsigned>(refs.size()), relativeMask};
+					relativeRefs.push_back(relative);
+				}
+
+				refs.push_back(ref);
+				p = skipWord(p, end);
+			}
+
+			face.refCount = static_cast<unsigned>(refs.size()) - face.firstRef;
+			faces.push_back(face);
+		}
+
+		// Negative indices count back from the last element, they are stored
+		// relative to the start of the chunk.
+		static bool parseIndex(const char *&p, const char *end, size_t count, unsigned bit, unsigned &index, unsigned &relativeMask)
+		{
+			long long value;
+			if (!parseInt(p, end, value)) return false;
+
+			// Indices beyond the unsigned range end up invalid
+			if (value < 0) {
+				index = static_cast<unsigned>(std::max(static_cast<long long>(count) + 1 + value, -(1LL << 31)));
+				relativeMask |= bit;
+			} else {
+				index = static_cast<unsigned>(std::min(value, 0xffffffffLL));
 			}
+			return true;
+		}
+
+		void setName(unsigned bit, const char *p, const char *end)
+		{
+			p = skipSpace(p, end);
+			while (end > p && isSpace(end[-1])) --end;
+
+			std::string &name = bit == ObjectBit ? object : bit == GroupBit ? group : material;
+			name.assign(p, end);
+			knownMask |= bit;
+
+			GroupStart start;
+			start.object = object;
+			start.group = group;
+			start.material = material;
+			start.knownMask = knownMask;
+			start.firstFace = static_cast<unsigned>(faces.size());
+			groups.push_back(start);
 		}
 	};
+
+	template <class T>
+	void copyRange(vector<T> &dst, size_t offset, const vector<T> &src)
+	{
+		std::copy(src.begin(), src.end(), dst.begin() + offset);
+	}
 }
 
-using namespace internal;
+ObjData ObjData::loadFromFile(const char *filename, swr::ThreadPool *pool)
+{
+	MappedFile file(filename);
+	return loadFromMemory(file.data(), file.size(), pool);
+}
 
-void ObjData::toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<int> &idata)
+ObjData ObjData::loadFromMemory(const char *data, size_t size, swr::ThreadPool *pool)
 {
-	vdata.clear();
-	idata.clear();
+	if (!pool)
+		pool = swr::ThreadPool::defaultPool();
+
+	// Split at line boundaries, a few chunks per thread for load balancing
+	size_t chunkCount = std::max<size_t>(1, std::min(size / MinChunkSize, static_cast<size_t>(pool->threadCount()) * 4));
+	vector<size_t> bounds(chunkCount + 1, size);
+	bounds[0] = 0;
+	for (size_t i = 1; i < chunkCount; ++i) {
+		size_t pos = std::max(bounds[i - 1], size / chunkCount * i);
+		const char *eol = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+		bounds[i] = eol ? eol - data + 1 : size;
+	}
+
+	vector<Chunk> chunks(chunkCount);
+	pool->parallelFor(static_cast<int>(chunkCount), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i)
+			chunks[i].parse(data + bounds[i], data + bounds[i + 1]);
+	});
+
+	// Element offsets of the chunks, behind the zero elements at index 0
+	struct Offsets {
+		size_t vertices, normals, texcoords, refs, faces;
+	};
+	vector<Offsets> offsets(chunkCount + 1);
+	offsets[0].vertices = offsets[0].normals = offsets[0].texcoords = 1;
+	offsets[0].refs = offsets[0].faces = 0;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		offsets[i + 1].vertices = offsets[i].vertices + chunks[i].vertices.size();
+		offsets[i + 1].normals = offsets[i].normals + chunks[i].normals.size();
+		offsets[i + 1].texcoords = offsets[i].texcoords + chunks[i].texcoords.size();
+		offsets[i + 1].refs = offsets[i].refs + chunks[i].refs.size();
+		offsets[i + 1].faces = offsets[i].faces + chunks[i].faces.size();
+	}
+
+	ObjData result;
+	const Offsets &total = offsets[chunkCount];
+	result.vertices.resize(total.vertices);
+	result.normals.resize(total.normals);
+	result.texcoords.resize(total.texcoords);
+	result.refs.resize(total.refs);
+	result.faces.resize(total.faces);
+	result.vertices[0] = vec3f(0.0f);
+	result.normals[0] = vec3f(0.0f);
+	result.texcoords[0] = vec2f(0.0f);
+
+	pool->parallelFor(static_cast<int>(chunkCount), 1, [&](int begin, int end) {
+		for (int i = begin; i < end; ++i) {
+			Chunk &chunk = chunks[i];
+			const Offsets &o = offsets[i];
+
+			copyRange(result.vertices, o.vertices, chunk.vertices);
+			copyRange(result.normals, o.normals, chunk.normals);
+			copyRange(result.texcoords, o.texcoords, chunk.texcoords);
+
+			for (size_t j = 0; j < chunk.relativeRefs.size(); ++j) {
+				VertexRef &ref = chunk.refs[chunk.relativeRefs[j].ref];
+				unsigned mask = chunk.relativeRefs[j].mask;
+				if (mask & Chunk::VertexBit) ref.vertexIndex += static_cast<unsigned>(o.vertices - 1);
+				if (mask & Chunk::NormalBit) ref.normalIndex += static_cast<unsigned>(o.normals - 1);
+				if (mask & Chunk::TexcoordBit) ref.texcoordIndex += static_cast<unsigned>(o.texcoords - 1);
+			}
+
+			// Out of range indices use the zero elements
+			for (size_t j = 0; j < chunk.refs.size(); ++j) {
+				VertexRef ref = chunk.refs[j];
+				if (ref.vertexIndex >= total.vertices) ref.vertexIndex = 0;
+				if (ref.normalIndex >= total.normals) ref.normalIndex = 0;
+				if (ref.texcoordIndex >= total.texcoords) ref.texcoordIndex = 0;
+				result.refs[o.refs + j] = ref;
+			}
+
+			for (size_t j = 0; j < chunk.faces.size(); ++j) {
+				Face face = chunk.faces[j];
+				face.firstRef += static_cast<unsigned>(o.refs);
+				result.faces[o.faces + j] = face;
+			}
+
+			// Only the group starts are needed from here on
+			vector<vec3f>().swap(chunk.vertices);
+			vector<vec3f>().swap(chunk.normals);
+			vector<vec2f>().swap(chunk.texcoords);
+			vector<VertexRef>().swap(chunk.refs);
+			vector<Face>().swap(chunk.faces);
+		}
+	});
+
+	// Names not set in a chunk carry over from the previous group
+	Group current;
+	current.firstFace = 0;
+	current.faceCount = 0;
+	result.groups.push_back(current);
+
+	for (size_t i = 0; i < chunkCount; ++i) {
+		for (size_t j = 0; j < chunks[i].groups.size(); ++j) {
+			const Chunk::GroupStart &start = chunks[i].groups[j];
+			if (start.knownMask & Chunk::ObjectBit) current.object = start.object;
+			if (start.knownMask & Chunk::GroupBit) current.group = start.group;
+			if (start.knownMask & Chunk::MaterialBit) current.material = start.material;
+			current.firstFace = static_cast<unsigned>(offsets[i].faces + start.firstFace);
+
+			if (result.groups.back().firstFace == current.firstFace)
+				result.groups.back() = current;
+			else
+				result.groups.push_back(current);
+		}
+	}
+
+	for (size_t i = 0; i < result.groups.size(); ++i) {
+		unsigned next = i + 1 < result.groups.size() ? result.groups[i + 1].firstFace : static_cast<unsigned>(total.faces);
+		result.groups[i].faceCount = next - result.groups[i].firstFace;
+	}
 
-	struct Helper {
-		vector<VertexArrayData> &m_vdata;
-		vector<int> &m_idata;
-		const ObjData &m_obj;
+	if (result.groups.back().faceCount == 0)
+		result.groups.pop_back();
 
-		typedef map<VertexRef, unsigned, internal::VertexRefCompare> vertex_index_map_t;
-		vertex_index_map_t vertex_index_map;
+	return result;
+}
 
-		Helper(const ObjData& obj, std::vector<VertexArrayData> &vdata, std::vector<int> &idata):
-			m_vdata(vdata), m_idata(idata), m_obj(obj) {}
+namespace {
+	// Open addressing hash table from VertexRef to vertex index with linear probing.
+	class VertexRefTable {
+	public:
+		explicit VertexRefTable(size_t expected = 0)
+			: m_count(0)
+		{
+			size_t capacity = 16;
+			while (capacity < expected * 2) capacity *= 2;
+			m_slots.resize(capacity);
+		}
 
-		void process() 
+		// Index of ref, which is set to index if ref is new.
+		unsigned insert(const ObjData::VertexRef &ref, unsigned index)
 		{
-			for (size_t i = 0; i < m_obj.faces.size(); ++i) {
-				unsigned i1 = addVertex(m_obj.faces[i][0]);
+			if ((m_count + 1) * 2 > m_slots.size()) grow();
+			return insertSlot(ref, index);
+		}
 
-				// make a triangle fan if there are more than 3 vertices
-				for (size_t j = 2; j < m_obj.faces[i].size(); ++j) {
-					unsigned i2 = addVertex(m_obj.faces[i][j-1]);
-					unsigned i3 = addVertex(m_obj.faces[i][j]);
+	private:
+		static const unsigned Empty = ~0u;
 
-					addFace(i1, i2, i3);
+		struct Slot {
+			ObjData::VertexRef ref;
+			unsigned index;
+
+			Slot() : index(Empty) {}
+		};
+
+		static size_t hash(const ObjData::VertexRef &ref)
+		{
+			uint64_t key = (static_cast<uint64_t>(ref.normalIndex) << 32) | ref.vertexIndex;
+			uint64_t h = key * 0x9e3779b97f4a7c15ull ^ ref.texcoordIndex * 0xc2b2ae3d27d4eb4full;
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+
+		unsigned insertSlot(const ObjData::VertexRef &ref, unsigned index)
+		{
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = hash(ref) & mask;; i = (i + 1) & mask) {
+				Slot &slot = m_slots[i];
+				if (slot.index == Empty) {
+					slot.ref = ref;
+					slot.index = index;
+					++m_count;
+					return index;
 				}
+				if (slot.ref.vertexIndex == ref.vertexIndex && slot.ref.normalIndex == ref.normalIndex && slot.ref.texcoordIndex == ref.texcoordIndex)
+					return slot.index;
 			}
 		}
 
-		unsigned addVertex(const VertexRef &v) 
+		void grow()
 		{
-			// check if this vertex already exists
-			vertex_index_map_t::const_iterator it = vertex_index_map.find(v);
-			if (it != vertex_index_map.end()) 
-				return it->second;
+			vector<Slot> slots(m_slots.size() * 2);
+			slots.swap(m_slots);
+			m_count = 0;
+			for (size_t i = 0; i < slots.size(); ++i) {
+				if (slots[i].index != Empty)
+					insertSlot(slots[i].ref, slots[i].index);
+			}
+		}
 
-			// does not exist, so insert a new one
-			unsigned i = static_cast<unsigned>(vertex_index_map.size());
-			vertex_index_map.insert(make_pair(v, i));
+		vector<Slot> m_slots;
+		size_t m_count;
+	};
 
-			VertexArrayData vd;
-			vd.vertex = m_obj.vertices[v.vertexIndex];
-			vd.normal = m_obj.normals[v.normalIndex];
-			vd.texcoord = m_obj.texcoords[v.texcoordIndex];
-			m_vdata.push_back(vd);
+	// A range of faces deduplicated on its own. Vertex ids are local to the
+	// part until the parts are merged.
+	struct FacePart {
+		size_t firstFace;
+		size_t endFace;
+		size_t firstIndex;
+		size_t indexCount;
+		vector<ObjData::VertexRef> vertices;
+		VertexRefTable table;
+
+		void deduplicate(const ObjData &obj, vector<unsigned> &refIds)
+		{
+			table = VertexRefTable((obj.faces[endFace - 1].firstRef + obj.faces[endFace - 1].refCount - obj.faces[firstFace].firstRef) / 4);
+			indexCount = 0;
+
+			for (size_t i = firstFace; i < endFace; ++i) {
+				const ObjData::Face &face = obj.faces[i];
+				if (face.refCount < 3) continue;
+
+				indexCount += (face.refCount - 2) * 3;
+				for (unsigned j = face.firstRef; j < face.firstRef + face.refCount; ++j) {
+					unsigned id = table.insert(obj.refs[j], static_cast<unsigned>(vertices.size()));
+					if (id == vertices.size())
+						vertices.push_back(obj.refs[j]);
+					refIds[j] = id;
+				}
+			}
+		}
+	};
 
-			return i;
+	// Split the faces into parts with about the same number of refs.
+	vector<FacePart> partitionFaces(const ObjData &obj, swr::ThreadPool *pool)
+	{
+		const size_t MinPartRefs = 1 << 16;
+
+		size_t refCount = obj.refs.size();
+		size_t partCount = std::max<size_t>(1, std::min(refCount / MinPartRefs, static_cast<size_t>(pool->threadCount()) * 4));
+
+		vector<FacePart> parts;
+		size_t face = 0;
+		for (size_t i = 0; i < partCount && face < obj.faces.size(); ++i) {
+			size_t endRef = refCount / partCount * (i + 1);
+			size_t end = face + 1;
+			if (i + 1 == partCount)
+				end = obj.faces.size();
+			else
+				while (end < obj.faces.size() && obj.faces[end].firstRef < endRef) ++end;
+
+			parts.push_back(FacePart());
+			parts.back().firstFace = face;
+			parts.back().endFace = end;
+			face = end;
 		}
+		return parts;
+	}
 
-		void addFace(int i1, int i2, int i3) 
-		{
-			m_idata.push_back(i1);
-			m_idata.push_back(i2);
-			m_idata.push_back(i3);
+	// Deduplicate the parts in parallel and merge them in order, so the
+	// vertices are ordered by first use for any number of parts. Leaves the
+	// vertex index of every ref in refIds.
+	void deduplicate(const ObjData &obj, vector<FacePart> &parts, vector<unsigned> &refIds, vector<ObjData::VertexArrayData> &vdata, swr::ThreadPool *pool)
+	{
+		pool->parallelFor(static_cast<int>(parts.size()), 1, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+				parts[i].deduplicate(obj, refIds);
+		});
+
+		// The ids of the first part are already global
+		VertexRefTable table;
+		vector<ObjData::VertexRef> vertices;
+		vector< vector<unsigned> > remaps(parts.size());
+		size_t firstIndex = 0;
+
+		for (size_t i = 0; i < parts.size(); ++i) {
+			FacePart &part = parts[i];
+			part.firstIndex = firstIndex;
+			firstIndex += part.indexCount;
+
+			if (i == 0) {
+				std::swap(table, part.table);
+				vertices.swap(part.vertices);
+				continue;
+			}
+
+			vector<unsigned> &remap = remaps[i];
+			remap.resize(part.vertices.size());
+			for (size_t j = 0; j < part.vertices.size(); ++j) {
+				unsigned id = table.insert(part.vertices[j], static_cast<unsigned>(vertices.size()));
+				if (id == vertices.size())
+					vertices.push_back(part.vertices[j]);
+				remap[j] = id;
+			}
+
+			part.table = VertexRefTable();
+			vector<ObjData::VertexRef>().swap(part.vertices);
 		}
 
-	} helper(*this, vdata, idata);
+		vdata.resize(vertices.size());
+		pool->parallelFor(static_cast<int>(parts.size()), 1, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) {
+				const FacePart &part = parts[i];
+
+				// Each part also converts its share of the vertices
+				size_t first = vertices.size() * i / parts.size();
+				size_t last = vertices.size() * (i + 1) / parts.size();
+				for (size_t j = first; j < last; ++j) {
+					const ObjData::VertexRef &ref = vertices[j];
+					vdata[j].vertex = obj.vertices[ref.vertexIndex];
+					vdata[j].normal = obj.normals[ref.normalIndex];
+					vdata[j].texcoord = obj.texcoords[ref.texcoordIndex];
+				}
+
+				if (i == 0) continue;
+
+				const vector<unsigned> &remap = remaps[i];
+				unsigned firstRef = obj.faces[part.firstFace].firstRef;
+				unsigned endRef = obj.faces[part.endFace - 1].firstRef + obj.faces[part.endFace - 1].refCount;
+				for (unsigned j = firstRef; j < endRef; ++j)
+					refIds[j] = remap[refIds[j]];
+			}
+		});
+	}
+
+	// Triangle fans of all faces with at least three vertices.
+	template <class Index>
+	void emitIndices(const ObjData &obj, const vector<FacePart> &parts, const vector<unsigned> &refIds, vector<Index> &idata, swr::ThreadPool *pool)
+	{
+		idata.resize(parts.empty() ? 0 : parts.back().firstIndex + parts.back().indexCount);
+
+		pool->parallelFor(static_cast<int>(parts.size()), 1, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) {
+				Index *out = idata.empty() ? nullptr : &idata[parts[i].firstIndex];
+				for (size_t f = parts[i].firstFace; f < parts[i].endFace; ++f) {
+					const ObjData::Face &face = obj.faces[f];
+					const unsigned *ids = &refIds[face.firstRef];
+					for (unsigned j = 2; j < face.refCount; ++j) {
+						*out++ = static_cast<Index>(ids[0]);
+						*out++ = static_cast<Index>(ids[j - 1]);
+						*out++ = static_cast<Index>(ids[j]);
+					}
+				}
+			}
+		});
+	}
+}
+
+void ObjData::toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<int> &idata, swr::ThreadPool *pool) const
+{
+	if (!pool)
+		pool = swr::ThreadPool::defaultPool();
+
+	vector<FacePart> parts = partitionFaces(*this, pool);
+	vector<unsigned> refIds(refs.size());
+	deduplicate(*this, parts, refIds, vdata, pool);
+	emitIndices(*this, parts, refIds, idata, pool);
+}
+
+bool ObjData::toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<uint16_t> &idata, swr::ThreadPool *pool) const
+{
+	if (!pool)
+		pool = swr::ThreadPool::defaultPool();
+
+	vector<FacePart> parts = partitionFaces(*this, pool);
+	vector<unsigned> refIds(refs.size());
+	deduplicate(*this, parts, refIds, vdata, pool);
+
+	if (vdata.size() > 0x10000) {
+		idata.clear();
+		return false;
+	}
 
-	helper.process();
+	emitIndices(*this, parts, refIds, idata, pool);
+	return true;
 }
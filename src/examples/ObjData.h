@@ -25,8 +25,15 @@ SOFTWARE.
 #pragma once
 
 #include "vector_math.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+namespace swr {
+	class ThreadPool;
+}
+
 // Use this class to load Obj files from disk 
 // and convert them to vertex arrays.
 struct ObjData {
@@ -36,23 +43,51 @@ struct ObjData {
 		vmath::vec2<float> texcoord;
 	};
 
+	// Indices into vertices, normals and texcoords. Index 0 is a zero
+	// element used for missing or invalid references.
 	struct VertexRef {
 		unsigned vertexIndex;
 		unsigned normalIndex;
 		unsigned texcoordIndex;
 	};
-	
-	typedef std::vector<VertexRef> Face;
+
+	// The vertex references of a face are consecutive in refs.
+	struct Face {
+		unsigned firstRef;
+		unsigned refCount;
+	};
+
+	// Faces following an o, g or usemtl statement. Names which were not
+	// set so far are empty.
+	struct Group {
+		std::string object;
+		std::string group;
+		std::string material;
+		unsigned firstFace;
+		unsigned faceCount;
+	};
 
 	std::vector< vmath::vec3<float> > vertices;
 	std::vector< vmath::vec3<float> > normals;
 	std::vector< vmath::vec2<float> > texcoords;
+	std::vector<VertexRef> refs;
 	std::vector<Face> faces;
+	std::vector<Group> groups;
 
-	// Load the .obj file
-	static ObjData loadFromFile(const char *filename);
+	// Load the .obj file. The file is mapped into memory and large files
+	// are parsed in parallel, pool nullptr uses swr::ThreadPool::defaultPool().
+	static ObjData loadFromFile(const char *filename, swr::ThreadPool *pool = nullptr);
 
-	// Convert to vertex and index array
-	void toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<int> &idata);
-};
+	// Parse .obj data in memory.
+	static ObjData loadFromMemory(const char *data, size_t size, swr::ThreadPool *pool = nullptr);
 
+	// Convert to vertex and index array. Faces become triangle fans and
+	// identical vertex references share a vertex, in order of first use.
+	// Large meshes are converted in parallel, pool nullptr uses
+	// swr::ThreadPool::defaultPool().
+	void toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<int> &idata, swr::ThreadPool *pool = nullptr) const;
+
+	// Convert with 16 bit indices. Returns false with idata empty if there
+	// are more than 65536 vertices.
+	bool toVertexArray(std::vector<VertexArrayData> &vdata, std::vector<uint16_t> &idata, swr::ThreadPool *pool = nullptr) const;
+};
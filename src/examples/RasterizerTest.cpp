@@ -33,9 +33,9 @@ public:
 	static const bool InterpolateW = false;
 	static const int AVarCount = 3;
 	
-	static SDL_Surface* surface;
+	SDL_Surface* surface;
 
-	static void drawPixel(const PixelData &p)
+	void drawPixel(const PixelData &p) const
 	{
 		int rint = (int)(p.avar[0] * 255);
 		int gint = (int)(p.avar[1] * 255);
@@ -48,14 +48,14 @@ public:
 	}
 };
 
-SDL_Surface* PixelShader::surface;
-
 void drawTriangle(SDL_Surface *screen)
 {
+	PixelShader shader;
+	shader.surface = screen;
+
 	Rasterizer r;
 	r.setScissorRect(0, 0, 640, 480);
-	r.setPixelShader<PixelShader>();
-	PixelShader::surface = screen;
+	r.setPixelShader(&shader);
 
 	RasterizerVertex v0, v1, v2;
 	
@@ -0,0 +1,323 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Renders the rotating box textured with data/box.png, once sampling with
+// Texture::sample and once with ReferenceSampler, the previous sampler that
+// wrapped coordinates with std::fmod, and compares the frame times.
+// Usage: TextureBenchmark [frames] [width height]
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "Renderer.h"
+#include "SimdConfig.h"
+#include "Texture.h"
+#include "ObjData.h"
+#include "vector_math.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+typedef vmath::vec3<float> vec3f;
+typedef vmath::vec4<float> vec4f;
+typedef vmath::mat4<float> mat4f;
+
+using namespace swr;
+
+// Texture::sample as it was before the address modes were added. Texels are
+// read through Texture::texel.
+class ReferenceSampler {
+public:
+    explicit ReferenceSampler(const Texture *texture, int maxAnisotropy = 8)
+        : m_texture(texture), m_maxAnisotropy(maxAnisotropy) {}
+
+    void sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy, uint32_t &outColor) const
+    {
+        u = std::fmod(u, 1.0f);
+        v = std::fmod(v, 1.0f);
+        if (u < 0) u += 1.0f;
+        if (v < 0) v += 1.0f;
+
+        float dudxScaled = dudx * m_texture->width();
+        float dvdxScaled = dvdx * m_texture->height();
+        float dudyScaled = dudy * m_texture->width();
+        float dvdyScaled = dvdy * m_texture->height();
+
+        float dxLen = std::max(std::sqrt(dudxScaled * dudxScaled + dvdxScaled * dvdxScaled), 1e-6f);
+        float dyLen = std::max(std::sqrt(dudyScaled * dudyScaled + dvdyScaled * dvdyScaled), 1e-6f);
+
+        float majorLen = std::max(dxLen, dyLen);
+        float minorLen = std::min(dxLen, dyLen);
+
+        float ratio = std::min(majorLen / minorLen, static_cast<float>(m_maxAnisotropy));
+        int numSamples = std::max(1, static_cast<int>(std::ceil(ratio)));
+
+        if (numSamples <= 1) {
+            sampleTrilinear(u, v, majorLen, outColor);
+            return;
+        }
+
+        float majorDu = dxLen > dyLen ? dudx / dxLen : dudy / dyLen;
+        float majorDv = dxLen > dyLen ? dvdx / dxLen : dvdy / dyLen;
+
+        int r = 0, g = 0, b = 0;
+        float step = 1.0f / numSamples;
+
+        for (int i = 0; i < numSamples; ++i) {
+            float t = (i + 0.5f) * step - 0.5f;
+            float sampleU = std::fmod(u + majorDu * majorLen * t, 1.0f);
+            float sampleV = std::fmod(v + majorDv * majorLen * t, 1.0f);
+            if (sampleU < 0) sampleU += 1.0f;
+            if (sampleV < 0) sampleV += 1.0f;
+
+            uint32_t sampleColor;
+            sampleTrilinear(sampleU, sampleV, minorLen, sampleColor);
+
+            r += (sampleColor >> 16) & 0xff;
+            g += (sampleColor >> 8) & 0xff;
+            b += sampleColor & 0xff;
+        }
+
+        outColor = ((r / numSamples) << 16) | ((g / numSamples) << 8) | (b / numSamples);
+    }
+
+private:
+    void sampleTrilinear(float u, float v, float rho, uint32_t &outColor) const
+    {
+        float lod = fastLog2(std::max(rho, 1e-6f));
+        lod = std::min(std::max(lod, 0.0f), static_cast<float>(m_texture->levelCount() - 1));
+
+        int lodBase = static_cast<int>(lod);
+        int lodNext = std::min(lodBase + 1, m_texture->levelCount() - 1);
+
+        uint32_t colorBase;
+        sampleBilinear(lodBase, u, v, colorBase);
+        if (lodBase != lodNext) {
+            uint32_t colorNext;
+            sampleBilinear(lodNext, u, v, colorNext);
+            outColor = lerpColors(colorBase, colorNext, static_cast<int>((lod - lodBase) * 256.0f));
+        } else {
+            outColor = colorBase;
+        }
+    }
+
+    void sampleBilinear(int level, float u, float v, uint32_t &outColor) const
+    {
+        int width = m_texture->width(level);
+        int height = m_texture->height(level);
+
+        float px = u * (width - 1);
+        float py = v * (height - 1);
+
+        int x0 = static_cast<int>(px);
+        int y0 = static_cast<int>(py);
+        int x1 = std::min(width - 1, x0 + 1);
+        int y1 = std::min(height - 1, y0 + 1);
+
+        int fx = static_cast<int>((px - x0) * 256.0f);
+        int fy = static_cast<int>((py - y0) * 256.0f);
+
+        uint32_t c00 = m_texture->texel(level, x0, y0);
+        uint32_t c10 = m_texture->texel(level, x1, y0);
+        uint32_t c01 = m_texture->texel(level, x0, y1);
+        uint32_t c11 = m_texture->texel(level, x1, y1);
+
+        outColor = lerpColors(lerpColors(c00, c01, fy), lerpColors(c10, c11, fy), fx);
+    }
+
+    static float fastLog2(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        float e = static_cast<float>(static_cast<int>(bits >> 23) - 128);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        return e + (-0.34484843f * m + 2.02466578f) * m - 0.67487759f;
+    }
+
+    static uint32_t lerpColors(uint32_t c1, uint32_t c2, int t)
+    {
+#ifdef SWR_USE_SSE2
+        __m128i v = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(c1), _mm_cvtsi32_si128(c2)), _mm_setzero_si128());
+        v = _mm_mullo_epi16(v, _mm_set_epi16(t, t, t, t, 256 - t, 256 - t, 256 - t, 256 - t));
+        v = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), 8);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(v, v))) & 0x00ffffff;
+#else
+        uint32_t result = 0;
+        for (int shift = 0; shift < 24; shift += 8)
+            result |= ((((c1 >> shift) & 0xff) * (256 - t) + ((c2 >> shift) & 0xff) * t) >> 8) << shift;
+        return result;
+#endif
+    }
+
+    const Texture *m_texture;
+    int m_maxAnisotropy;
+};
+
+template <class Sampler>
+class PixelShader : public PixelShaderBase<PixelShader<Sampler> > {
+public:
+    static const bool InterpolateZ = false;
+    static const bool InterpolateW = true;
+    static const int AVarCount = 0;
+    static const int PVarCount = 2;
+    static const bool ColorOutput = true;
+
+    const Sampler *sampler;
+
+    uint32_t shadePixel(const PixelData &p) const
+    {
+        float dudx, dudy, dvdx, dvdy;
+        p.computePerspectiveDerivatives(*p.equations, 0, dudx, dudy);
+        p.computePerspectiveDerivatives(*p.equations, 1, dvdx, dvdy);
+
+        uint32_t color;
+        sampler->sample(p.pvar[0], p.pvar[1], dudx, dvdx, dudy, dvdy, color);
+        return 0xff000000 | color;
+    }
+};
+
+class VertexShader : public VertexShaderBase<VertexShader> {
+public:
+    static const int AttribCount = 1;
+    static const int AVarCount = 0;
+    static const int PVarCount = 2;
+
+    mat4f modelViewProjectionMatrix;
+
+    void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
+    {
+        const ObjData::VertexArrayData *data = static_cast<const ObjData::VertexArrayData*>(in[0]);
+
+        vec4f position = modelViewProjectionMatrix * vec4f(data->vertex, 1.0f);
+
+        out->x = position.x;
+        out->y = position.y;
+        out->z = position.z;
+        out->w = position.w;
+        out->pvar[0] = data->texcoord.x;
+        out->pvar[1] = data->texcoord.y;
+    }
+};
+
+// Render the same camera path as Box and return the milliseconds per frame.
+template <class Sampler>
+static double renderFrames(const Sampler &sampler, int frames, int width, int height,
+    const std::vector<ObjData::VertexArrayData> &vdata, const std::vector<int> &idata)
+{
+    RenderTarget colorTarget(width, height, RenderTargetFormat::RGBA8);
+
+    PixelShader<Sampler> pixelShader;
+    pixelShader.sampler = &sampler;
+    VertexShader vertexShader;
+
+    Rasterizer r;
+    VertexProcessor v(&r);
+
+    r.setRenderTargets(&colorTarget);
+    r.setRasterMode(RasterMode::Span);
+    r.setScissorRect(0, 0, width, height);
+    r.setPixelShader(&pixelShader);
+
+    v.setViewport(0, 0, width, height);
+    v.setCullMode(CullMode::CW);
+    v.setVertexShader(&vertexShader);
+    v.setVertexAttribPointer(0, sizeof(ObjData::VertexArrayData), &vdata[0]);
+
+    mat4f perspectiveMatrix = vmath::perspective_matrix(60.0f, (float)width / height, 0.1f, 10.0f);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int frame = 0; frame < frames; ++frame) {
+        float angle = frame * (1.0f / 60.0f) * 0.5f;
+        float camX = 5.0f * cos(angle);
+        float camZ = 5.0f * sin(angle);
+
+        mat4f lookAtMatrix = vmath::lookat_matrix(vec3f(camX, 2.0f, camZ), vec3f(0.0f), vec3f(0.0f, 1.0f, 0.0f));
+        vertexShader.modelViewProjectionMatrix = perspectiveMatrix * lookAtMatrix;
+
+        colorTarget.clear(0xff000000);
+        v.drawElements(DrawMode::Triangle, idata.size(), &idata[0]);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / std::max(frames, 1);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200;
+    int width = argc > 3 ? std::atoi(argv[2]) : 640;
+    int height = argc > 3 ? std::atoi(argv[3]) : 480;
+
+    if (frames <= 0 || width <= 0 || height <= 0) {
+        fprintf(stderr, "Usage: TextureBenchmark [frames] [width height]\n");
+        return 1;
+    }
+
+    SDL_Surface *tmp = IMG_Load("data/box.png");
+    if (!tmp) {
+        fprintf(stderr, "Could not load texture! SDL_image Error: %s\n", IMG_GetError());
+        return 1;
+    }
+
+    SDL_Surface *image = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(tmp);
+    if (!image) {
+        fprintf(stderr, "Could not convert texture surface! SDL Error: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    Texture texture((const uint32_t*)image->pixels, image->w, image->h, image->pitch);
+    SDL_FreeSurface(image);
+
+    try {
+        std::vector<ObjData::VertexArrayData> vdata;
+        std::vector<int> idata;
+        ObjData::loadFromFile("data/box.obj").toVertexArray(vdata, idata);
+
+        ReferenceSampler reference(&texture);
+
+        // Warm up caches before the timed runs
+        renderFrames(texture, 10, width, height, vdata, idata);
+
+        double referenceTime = renderFrames(reference, frames, width, height, vdata, idata);
+        double samplerTime = renderFrames(texture, frames, width, height, vdata, idata);
+
+        printf("%d frames at %dx%d\n", frames, width, height);
+        printf("reference sampler: %.3f ms/frame\n", referenceTime);
+        printf("texture sampler:   %.3f ms/frame (%.2fx)\n", samplerTime, referenceTime / samplerTime);
+
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -34,9 +34,9 @@ public:
 	static const int AVarCount = 3;
 	static const int PVarCount = 0;
 	
-	static SDL_Surface* surface;
+	SDL_Surface* surface;
 
-	static void drawPixel(const PixelData &p)
+	void drawPixel(const PixelData &p) const
 	{
 		int rint = (int)(p.avar[0] * 255);
 		int gint = (int)(p.avar[1] * 255);
@@ -49,8 +49,6 @@ public:
 	}
 };
 
-SDL_Surface* PixelShader::surface;
-
 struct VertexData {
 	float x, y, z;
 	float r, g, b;
@@ -62,7 +60,7 @@ public:
 	static const int AVarCount = 3;
 	static const int PVarCount = 0;
 
-	static void processVertex(VertexShaderInput in, VertexShaderOutput *out)
+	void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
 	{
 		const VertexData *data = static_cast<const VertexData*>(in[0]);
 		out->x = data->x;
@@ -77,16 +75,20 @@ public:
 
 void drawTriangles(SDL_Surface *s)
 {
+	PixelShader pixelShader;
+	pixelShader.surface = s;
+
+	VertexShader vertexShader;
+
 	Rasterizer r;
 	VertexProcessor v(&r);
 
 	r.setScissorRect(0, 0, 640, 480);
-	r.setPixelShader<PixelShader>();
-	PixelShader::surface = s;
+	r.setPixelShader(&pixelShader);
 
 	v.setViewport(100, 100, 640 - 200, 480 - 200);
 	v.setCullMode(CullMode::None);
-	v.setVertexShader<VertexShader>();
+	v.setVertexShader(&vertexShader);
 
 	VertexData vdata[3];
 
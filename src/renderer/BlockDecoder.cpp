@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BlockDecoder.h"
+
+namespace swr {
+
+namespace {
+
+uint32_t expand565(unsigned color)
+{
+	unsigned r = (color >> 11) & 0x1f;
+	unsigned g = (color >> 5) & 0x3f;
+	unsigned b = color & 0x1f;
+	return ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+// Blend two 0x00RRGGBB colors per channel with weights wa and wb.
+uint32_t blendColors(uint32_t a, uint32_t b, unsigned wa, unsigned wb)
+{
+	uint32_t result = 0;
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		unsigned ca = (a >> shift) & 0xff;
+		unsigned cb = (b >> shift) & 0xff;
+		result |= ((ca * wa + cb * wb) / (wa + wb)) << shift;
+	}
+	return result;
+}
+
+// The three color modes of BC1 are only used if the block is not part of
+// a BC3 block.
+void decodeColors(const unsigned char *block, bool allowAlpha, uint32_t *texels)
+{
+	unsigned c0 = block[0] | block[1] << 8;
+	unsigned c1 = block[2] | block[3] << 8;
+	uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+
+	uint32_t palette[4];
+	palette[0] = 0xff000000 | expand565(c0);
+	palette[1] = 0xff000000 | expand565(c1);
+
+	if (c0 > c1 || !allowAlpha)
+	{
+		palette[2] = 0xff000000 | blendColors(palette[0], palette[1], 2, 1);
+		palette[3] = 0xff000000 | blendColors(palette[0], palette[1], 1, 2);
+	}
+	else
+	{
+		palette[2] = 0xff000000 | blendColors(palette[0], palette[1], 1, 1);
+		palette[3] = 0;
+	}
+
+	for (int i = 0; i < 16; ++i, indices >>= 2)
+		texels[i] = palette[indices & 3];
+}
+
+// Decode the 16 values of a BC4 channel.
+void decodeChannel(const unsigned char *block, unsigned char *values)
+{
+	unsigned a0 = block[0];
+	unsigned a1 = block[1];
+
+	unsigned char palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+
+	if (a0 > a1)
+	{
+		for (unsigned i = 1; i < 7; ++i)
+			palette[i + 1] = (unsigned char)((a0 * (7 - i) + a1 * i) / 7);
+	}
+	else
+	{
+		for (unsigned i = 1; i < 5; ++i)
+			palette[i + 1] = (unsigned char)((a0 * (5 - i) + a1 * i) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	// Two groups of eight 3 bit indices in 24 bits each
+	for (int half = 0; half < 2; ++half)
+	{
+		const unsigned char *bits = block + 2 + half * 3;
+		uint32_t indices = bits[0] | bits[1] << 8 | bits[2] << 16;
+		for (int i = 0; i < 8; ++i, indices >>= 3)
+			values[half * 8 + i] = palette[indices & 7];
+	}
+}
+
+} // end anonymous namespace
+
+void decodeBC1(const unsigned char *block, uint32_t *texels)
+{
+	decodeColors(block, true, texels);
+}
+
+void decodeBC3(const unsigned char *block, uint32_t *texels)
+{
+	unsigned char alpha[16];
+	decodeChannel(block, alpha);
+	decodeColors(block + 8, false, texels);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i] = (texels[i] & 0x00ffffff) | (uint32_t)alpha[i] << 24;
+}
+
+void decodeBC4(const unsigned char *block, uint32_t *texels)
+{
+	unsigned char red[16];
+	decodeChannel(block, red);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i] = 0xff000000 | (uint32_t)red[i] << 16;
+}
+
+void decodeBC5(const unsigned char *block, uint32_t *texels)
+{
+	unsigned char red[16];
+	unsigned char green[16];
+	decodeChannel(block, red);
+	decodeChannel(block + 8, green);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i] = 0xff000000 | (uint32_t)red[i] << 16 | (uint32_t)green[i] << 8;
+}
+
+} // end namespace swr
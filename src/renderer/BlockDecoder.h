@@ -0,0 +1,49 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstdint>
+
+namespace swr {
+
+// Decoders for the 4x4 texel blocks of block compressed formats. Each
+// function reads one block and writes its 16 texels row by row as
+// 0xAARRGGBB.
+
+/// BC1 (DXT1): RGB565 end points with 2 bit indices and 1 bit alpha.
+void decodeBC1(const unsigned char *block, uint32_t *texels);
+
+/// BC3 (DXT5): BC4 alpha followed by a BC1 color block.
+void decodeBC3(const unsigned char *block, uint32_t *texels);
+
+/// BC4: one 8 bit channel with 3 bit indices, decoded to opaque red.
+void decodeBC4(const unsigned char *block, uint32_t *texels);
+
+/// BC5: two BC4 channels, decoded to opaque red and green.
+void decodeBC5(const unsigned char *block, uint32_t *texels);
+
+} // end namespace swr
@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Culling.h"
+
+#include <cmath>
+
+namespace swr {
+
+namespace {
+
+inline float dot3(const float *a, const float *b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline float det3(float a0, float a1, float a2, float b0, float b1, float b2, float c0, float c1, float c2)
+{
+	return a0 * (b1 * c2 - b2 * c1) - a1 * (b0 * c2 - b2 * c0) + a2 * (b0 * c1 - b1 * c0);
+}
+
+} // end anonymous namespace
+
+Frustum::Frustum(const float *clipMatrix)
+{
+	for (int i = 0; i < 16; ++i)
+		m_matrix[i] = clipMatrix[i];
+
+	const float *x = m_matrix;
+	const float *y = m_matrix + 4;
+	const float *z = m_matrix + 8;
+	const float *w = m_matrix + 12;
+
+	// -w <= x, y, z <= w, each as a plane with the normal pointing inside
+	for (int i = 0; i < 4; ++i) {
+		m_planes[0][i] = w[i] + x[i];
+		m_planes[1][i] = w[i] - x[i];
+		m_planes[2][i] = w[i] + y[i];
+		m_planes[3][i] = w[i] - y[i];
+		m_planes[4][i] = w[i] + z[i];
+		m_planes[5][i] = w[i] - z[i];
+	}
+
+	for (int p = 0; p < 6; ++p) {
+		float length = std::sqrt(dot3(m_planes[p], m_planes[p]));
+		if (length > 0.0f) {
+			for (int i = 0; i < 4; ++i)
+				m_planes[p][i] /= length;
+		}
+	}
+
+	// Generalized cross product of the x, y and w rows, its sign chosen to
+	// match the triangle orientation of the rasterizer
+	m_eye[0] = -det3(x[1], x[2], x[3], y[1], y[2], y[3], w[1], w[2], w[3]);
+	m_eye[1] = det3(x[0], x[2], x[3], y[0], y[2], y[3], w[0], w[2], w[3]);
+	m_eye[2] = -det3(x[0], x[1], x[3], y[0], y[1], y[3], w[0], w[1], w[3]);
+	m_eye[3] = det3(x[0], x[1], x[2], y[0], y[1], y[2], w[0], w[1], w[2]);
+}
+
+Visibility Frustum::classify(const BoundingSphere &sphere) const
+{
+	Visibility result = Visibility::Inside;
+
+	for (int p = 0; p < 6; ++p) {
+		float distance = dot3(m_planes[p], sphere.center) + m_planes[p][3];
+		if (distance < -sphere.radius)
+			return Visibility::Outside;
+		if (distance < sphere.radius)
+			result = Visibility::Intersecting;
+	}
+
+	return result;
+}
+
+Visibility Frustum::classify(const BoundingBox &box) const
+{
+	Visibility result = Visibility::Inside;
+
+	for (int p = 0; p < 6; ++p) {
+		const float *plane = m_planes[p];
+
+		// Corners farthest along and against the plane normal
+		float inner[3], outer[3];
+		for (int i = 0; i < 3; ++i) {
+			inner[i] = plane[i] >= 0.0f ? box.max[i] : box.min[i];
+			outer[i] = plane[i] >= 0.0f ? box.min[i] : box.max[i];
+		}
+
+		if (dot3(plane, inner) + plane[3] < 0.0f)
+			return Visibility::Outside;
+		if (dot3(plane, outer) + plane[3] < 0.0f)
+			result = Visibility::Intersecting;
+	}
+
+	return result;
+}
+
+bool Frustum::isBackFacing(const Meshlet &meshlet, CullMode cullMode) const
+{
+	if (cullMode == CullMode::None || meshlet.coneCutoff >= 1.0f)
+		return false;
+
+	// A triangle with normal n at point p is culled by CullMode::CW if
+	// dot(n, eye.xyz - eye.w * p) is positive. All triangles are if the
+	// cone around the axis is within 90 degrees of that vector for every
+	// point of the bounding sphere.
+	const float *center = meshlet.bounds.center;
+	float toEye[3];
+	for (int i = 0; i < 3; ++i)
+		toEye[i] = m_eye[i] - m_eye[3] * center[i];
+
+	float spread = std::fabs(m_eye[3]) * meshlet.bounds.radius;
+	float along = dot3(toEye, meshlet.coneAxis);
+	if (cullMode == CullMode::CCW)
+		along = -along;
+
+	return along - spread > meshlet.coneCutoff * (std::sqrt(dot3(toEye, toEye)) + spread);
+}
+
+void Frustum::transform(const float *position, float *clip) const
+{
+	for (int r = 0; r < 4; ++r) {
+		const float *row = m_matrix + r * 4;
+		clip[r] = row[0] * position[0] + row[1] * position[1] + row[2] * position[2] + row[3];
+	}
+}
+
+} // end namespace swr
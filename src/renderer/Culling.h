@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include "IRasterizer.h"
+
+namespace swr {
+
+/// Bounding sphere in object space.
+struct BoundingSphere {
+	float center[3];
+	float radius;
+};
+
+/// Axis aligned bounding box in object space.
+struct BoundingBox {
+	float min[3];
+	float max[3];
+};
+
+/// Result of testing bounds against the view frustum.
+enum class Visibility {
+	Outside,      ///< Nothing inside the bounds can be visible.
+	Intersecting, ///< The bounds cross at least one frustum plane.
+	Inside        ///< The bounds are completely inside, nothing needs clipping.
+};
+
+/// Cluster of triangles with bounds for culling before vertex processing.
+/** The triangles are a contiguous range of an index buffer. The normal
+  cone contains the normals of all triangles, computed from counter
+  clockwise vertex order. See buildMeshlets(). */
+struct Meshlet {
+	unsigned firstIndex;    ///< Position of the first index in the index buffer.
+	unsigned triangleCount; ///< Number of triangles, the range has three times as many indices.
+	BoundingSphere bounds;
+	float coneAxis[3];      ///< Average normal direction.
+	float coneCutoff;       ///< Sine of the cone half angle, 1 if the cone is too wide for culling.
+};
+
+/// View frustum in object space.
+/** Built from the matrix transforming object space positions to clip
+  space, the one the vertex shader applies. The matrix is given as 16
+  floats row by row, the layout of vmath::mat4 in the examples. The
+  frustum is -w <= x, y, z <= w in clip space, as clipped by
+  VertexProcessor. */
+class Frustum {
+public:
+	/// Constructor.
+	explicit Frustum(const float *clipMatrix);
+
+	/// Test a bounding sphere against the frustum planes.
+	Visibility classify(const BoundingSphere &sphere) const;
+
+	/// Test a bounding box against the frustum planes.
+	Visibility classify(const BoundingBox &box) const;
+
+	/// Whether all triangles of a meshlet are culled with the given mode.
+	/** Tests the normal cone from all points of the bounding sphere, so
+	  it is conservative for both perspective and parallel projections. */
+	bool isBackFacing(const Meshlet &meshlet, CullMode cullMode) const;
+
+	/// Transform a position to clip space.
+	void transform(const float *position, float *clip) const;
+
+private:
+	float m_matrix[16];
+	float m_planes[6][4];
+
+	// Homogeneous eye position, the point mapped to x = y = w = 0. Its w
+	// is 0 for parallel projections.
+	float m_eye[4];
+};
+
+} // end namespace swr
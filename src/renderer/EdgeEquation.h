@@ -42,6 +42,15 @@ struct EdgeEquation {
 		tie = a != 0 ? a > 0 : b > 0;
 	}
 
+	// Set this to the equation of edge e with reversed direction.
+	void flip(const EdgeEquation &e)
+	{
+		a = -e.a;
+		b = -e.b;
+		c = -e.c;
+		tie = a != 0 ? a > 0 : b > 0;
+	}
+
 	// Evaluate the edge equation for the given point.
 	float evaluate(float x, float y) const
 	{
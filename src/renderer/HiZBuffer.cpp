@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HiZBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace swr {
+
+HiZBuffer::HiZBuffer()
+	: m_width(0)
+	, m_height(0)
+{
+}
+
+void HiZBuffer::update(const RenderTarget &depth)
+{
+	assert(depth.format() == RenderTargetFormat::D32F || depth.format() == RenderTargetFormat::R32F);
+
+	m_width = depth.width();
+	m_height = depth.height();
+
+	uint32_t clearBits = depth.clearValue();
+	float clearDepth;
+	memcpy(&clearDepth, &clearBits, sizeof(clearDepth));
+
+	// Level 0, one texel per tile
+	Level base;
+	base.width = depth.tilesX();
+	base.height = depth.tilesY();
+	base.depth.resize((size_t)base.width * base.height);
+
+	for (int ty = 0; ty < base.height; ++ty) {
+		for (int tx = 0; tx < base.width; ++tx) {
+			float farthest = clearDepth;
+
+			if (!depth.isTileCleared(tx, ty)) {
+				const float *tile = reinterpret_cast<const float*>(depth.tile(tx, ty));
+				int w = std::min(RenderTarget::TileSize, m_width - tx * RenderTarget::TileSize);
+				int h = std::min(RenderTarget::TileSize, m_height - ty * RenderTarget::TileSize);
+
+				farthest = tile[0];
+				for (int y = 0; y < h; ++y) {
+					for (int x = 0; x < w; ++x)
+						farthest = std::max(farthest, tile[y * RenderTarget::TileSize + x]);
+				}
+			}
+
+			base.depth[(size_t)ty * base.width + tx] = farthest;
+		}
+	}
+
+	m_levels.clear();
+	m_levels.push_back(base);
+
+	while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+		const Level &below = m_levels.back();
+
+		Level level;
+		level.width = (below.width + 1) / 2;
+		level.height = (below.height + 1) / 2;
+		level.depth.resize((size_t)level.width * level.height);
+
+		for (int y = 0; y < level.height; ++y) {
+			for (int x = 0; x < level.width; ++x) {
+				int x0 = x * 2, x1 = std::min(x * 2 + 1, below.width - 1);
+				int y0 = y * 2, y1 = std::min(y * 2 + 1, below.height - 1);
+				const float *row0 = &below.depth[(size_t)y0 * below.width];
+				const float *row1 = &below.depth[(size_t)y1 * below.width];
+				level.depth[(size_t)y * level.width + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+
+		m_levels.push_back(level);
+	}
+}
+
+bool HiZBuffer::isOccluded(int x0, int y0, int x1, int y1, float minDepth) const
+{
+	if (m_levels.empty())
+		return false;
+
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, m_width - 1);
+	y1 = std::min(y1, m_height - 1);
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Go up until the rectangle covers at most 2x2 texels
+	x0 /= RenderTarget::TileSize;
+	y0 /= RenderTarget::TileSize;
+	x1 /= RenderTarget::TileSize;
+	y1 /= RenderTarget::TileSize;
+
+	size_t l = 0;
+	while (l + 1 < m_levels.size() && (x1 - x0 > 1 || y1 - y0 > 1)) {
+		x0 >>= 1;
+		y0 >>= 1;
+		x1 >>= 1;
+		y1 >>= 1;
+		l++;
+	}
+
+	const Level &level = m_levels[l];
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			if (minDepth <= level.depth[(size_t)y * level.width + x])
+				return false;
+		}
+	}
+
+	return true;
+}
+
+} // end namespace swr
@@ -0,0 +1,72 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <vector>
+
+#include "RenderTarget.h"
+
+namespace swr {
+
+/// Hierarchical depth buffer for occlusion culling.
+/** Level 0 holds the farthest depth of each tile of a depth target, each
+  further level the farthest of 2x2 texels of the level below. Built from
+  a depth pre-pass or from the previous frame, it tells whether a screen
+  rectangle is certainly hidden. Assumes DepthFunc::Less or LessEqual.
+  With the previous frame, objects which became visible through camera
+  movement may be missing for one frame. */
+class HiZBuffer {
+public:
+	HiZBuffer();
+
+	/// Build the levels from a D32F or R32F target.
+	/** Tiles which are still cleared are taken from the clear value
+	  without being filled. */
+	void update(const RenderTarget &depth);
+
+	/// Whether update() has been called.
+	bool isValid() const { return !m_levels.empty(); }
+
+	/// Whether everything in a pixel rectangle is hidden.
+	/** The rectangle [x0, x1] x [y0, y1] is hidden if minDepth is farther
+	  than all depths stored inside it. Parts outside the target are
+	  ignored. */
+	bool isOccluded(int x0, int y0, int x1, int y1, float minDepth) const;
+
+private:
+	struct Level {
+		int width;
+		int height;
+		std::vector<float> depth;
+	};
+
+	int m_width;
+	int m_height;
+	std::vector<Level> m_levels;
+};
+
+} // end namespace swr
@@ -38,6 +38,13 @@ const int MaxAVars = 16;
 /// Maximum perspective variables used for interpolation across the triangle.
 const int MaxPVars = 16;
 
+/// Triangle culling mode.
+enum class CullMode {
+	None,
+	CCW,
+	CW
+};
+
 /// Vertex input structure for the Rasterizer. Output from the VertexProcessor.
 struct RasterizerVertex {
 	float x; ///< The x component.
@@ -66,8 +73,9 @@ public:
 	virtual void drawLineList(const RasterizerVertex *vertices, const int *indices, size_t indexCount) const = 0;
 
 	/// Draw a list of triangles.
-	/** Triangles  with indices == -1 will be ignored. */
-	virtual void drawTriangleList(const RasterizerVertex *vertices, const int *indices, size_t indexCount) const = 0;
+	/** Triangles  with indices == -1 will be ignored. Triangles facing
+	  away according to cullMode are discarded by the rasterizer. */
+	virtual void drawTriangleList(const RasterizerVertex *vertices, const int *indices, size_t indexCount, CullMode cullMode) const = 0;
 };
 
 } // end namespace swr
\ No newline at end of file
@@ -0,0 +1,348 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef SWR_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace swr {
+
+namespace {
+
+bool isFloatFormat(RenderTargetFormat format)
+{
+	return format == RenderTargetFormat::R32F || format == RenderTargetFormat::D32F;
+}
+
+// Convert row y to 8 bit RGB or, for float formats, 8 bit gray.
+void convertRow(const Image &image, int y, unsigned char *dst)
+{
+	const unsigned char *src = image.pixels.data() + (size_t)y * image.pitch();
+
+	switch (image.format)
+	{
+		case RenderTargetFormat::RGBA8:
+			for (int x = 0; x < image.width; ++x, src += 4)
+			{
+				*dst++ = src[2];
+				*dst++ = src[1];
+				*dst++ = src[0];
+			}
+			break;
+		case RenderTargetFormat::RGB565:
+			for (int x = 0; x < image.width; ++x, src += 2)
+			{
+				uint16_t c;
+				std::memcpy(&c, src, 2);
+				unsigned r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+				*dst++ = (unsigned char)(r << 3 | r >> 2);
+				*dst++ = (unsigned char)(g << 2 | g >> 4);
+				*dst++ = (unsigned char)(b << 3 | b >> 2);
+			}
+			break;
+		case RenderTargetFormat::R32F:
+		case RenderTargetFormat::D32F:
+			for (int x = 0; x < image.width; ++x, src += 4)
+			{
+				float f;
+				std::memcpy(&f, src, 4);
+				f = std::min(std::max(f, 0.0f), 1.0f);
+				*dst++ = (unsigned char)(f * 255.0f + 0.5f);
+			}
+			break;
+	}
+}
+
+bool writeFile(const std::string &path, const void *data, size_t size)
+{
+	std::FILE *file = std::fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool ok = std::fwrite(data, 1, size, file) == size;
+	return std::fclose(file) == 0 && ok;
+}
+
+bool writePPM(const Image &image, const std::string &path)
+{
+	int channels = isFloatFormat(image.format) ? 1 : 3;
+
+	char header[64];
+	int headerSize = std::snprintf(header, sizeof(header), "P%d\n%d %d\n255\n", channels == 1 ? 5 : 6, image.width, image.height);
+
+	std::vector<unsigned char> data(header, header + headerSize);
+	size_t rowSize = (size_t)image.width * channels;
+	data.resize(headerSize + rowSize * image.height);
+
+	for (int y = 0; y < image.height; ++y)
+		convertRow(image, y, data.data() + headerSize + y * rowSize);
+
+	return writeFile(path, data.data(), data.size());
+}
+
+uint32_t crc32Update(uint32_t crc, const unsigned char *data, size_t size)
+{
+	static uint32_t table[256];
+	static bool initialized = [] {
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return true;
+	}();
+	(void)initialized;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+void appendBigEndian(std::vector<unsigned char> &out, uint32_t v)
+{
+	out.push_back((unsigned char)(v >> 24));
+	out.push_back((unsigned char)(v >> 16));
+	out.push_back((unsigned char)(v >> 8));
+	out.push_back((unsigned char)v);
+}
+
+void appendChunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, size_t size)
+{
+	appendBigEndian(out, (uint32_t)size);
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data, data + size);
+	appendBigEndian(out, crc32Update(0, out.data() + start, size + 4));
+}
+
+// Wrap data in a zlib stream.
+std::vector<unsigned char> deflateData(const std::vector<unsigned char> &data)
+{
+	std::vector<unsigned char> out;
+
+#ifdef SWR_HAVE_ZLIB
+	uLongf size = compressBound((uLong)data.size());
+	out.resize(size);
+	if (compress2(out.data(), &size, data.data(), (uLong)data.size(), Z_BEST_SPEED) == Z_OK)
+	{
+		out.resize(size);
+		return out;
+	}
+	out.clear();
+#endif
+
+	// Stored blocks without compression.
+	out.push_back(0x78);
+	out.push_back(0x01);
+
+	size_t pos = 0;
+	do
+	{
+		size_t blockSize = std::min<size_t>(data.size() - pos, 65535);
+		bool final = pos + blockSize == data.size();
+		out.push_back(final ? 1 : 0);
+		out.push_back((unsigned char)blockSize);
+		out.push_back((unsigned char)(blockSize >> 8));
+		out.push_back((unsigned char)~blockSize);
+		out.push_back((unsigned char)(~blockSize >> 8));
+		out.insert(out.end(), data.begin() + pos, data.begin() + pos + blockSize);
+		pos += blockSize;
+	} while (pos < data.size());
+
+	uint32_t a = 1, b = 0;
+	for (unsigned char c : data)
+	{
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	appendBigEndian(out, b << 16 | a);
+
+	return out;
+}
+
+bool writePNG(const Image &image, const std::string &path)
+{
+	int channels = isFloatFormat(image.format) ? 1 : 3;
+
+	// Each row starts with filter type 0.
+	size_t rowSize = (size_t)image.width * channels + 1;
+	std::vector<unsigned char> rows(rowSize * image.height);
+	for (int y = 0; y < image.height; ++y)
+	{
+		rows[y * rowSize] = 0;
+		convertRow(image, y, rows.data() + y * rowSize + 1);
+	}
+
+	std::vector<unsigned char> out;
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	out.insert(out.end(), signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	appendBigEndian(header, image.width);
+	appendBigEndian(header, image.height);
+	header.push_back(8); // bit depth
+	header.push_back(channels == 1 ? 0 : 2); // gray or RGB
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // no interlace
+	appendChunk(out, "IHDR", header.data(), header.size());
+
+	std::vector<unsigned char> compressed = deflateData(rows);
+	appendChunk(out, "IDAT", compressed.data(), compressed.size());
+	appendChunk(out, "IEND", nullptr, 0);
+
+	return writeFile(path, out.data(), out.size());
+}
+
+} // end anonymous namespace
+
+void Image::assign(const RenderTarget &target)
+{
+	width = target.width();
+	height = target.height();
+	format = target.format();
+	pixels.resize((size_t)pitch() * height);
+	target.copyToLinear(pixels.data(), pitch());
+}
+
+bool writeImage(const Image &image, const std::string &path, ImageFormat format)
+{
+	switch (format)
+	{
+		case ImageFormat::Raw:
+			return writeFile(path, image.pixels.data(), image.pixels.size());
+		case ImageFormat::PPM:
+			return writePPM(image, path);
+		case ImageFormat::PNG:
+			return writePNG(image, path);
+	}
+
+	return false;
+}
+
+bool writeImage(const RenderTarget &target, const std::string &path, ImageFormat format)
+{
+	Image image;
+	image.assign(target);
+	return writeImage(image, path, format);
+}
+
+AsyncImageWriter::AsyncImageWriter(size_t maxPending)
+	: m_maxPending(std::max<size_t>(maxPending, 1))
+	, m_pending(0)
+	, m_failed(0)
+	, m_stop(false)
+	, m_thread(&AsyncImageWriter::run, this)
+{
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void AsyncImageWriter::write(const RenderTarget &target, const std::string &path, ImageFormat format)
+{
+	Job job;
+	job.path = path;
+	job.format = format;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending < m_maxPending; });
+		++m_pending;
+
+		if (!m_freeImages.empty())
+		{
+			job.image = std::move(m_freeImages.back());
+			m_freeImages.pop_back();
+		}
+	}
+
+	// Copy outside the lock, the writer thread keeps running meanwhile.
+	job.image.assign(target);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(job));
+	}
+
+	m_wake.notify_one();
+}
+
+void AsyncImageWriter::flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+size_t AsyncImageWriter::failedWrites() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_failed;
+}
+
+void AsyncImageWriter::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;)
+	{
+		m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+		if (m_queue.empty())
+			return;
+
+		Job job = std::move(m_queue.front());
+		m_queue.pop_front();
+
+		lock.unlock();
+		bool ok = writeImage(job.image, job.path, job.format);
+		lock.lock();
+
+		if (!ok)
+			++m_failed;
+
+		m_freeImages.push_back(std::move(job.image));
+		--m_pending;
+		m_done.notify_all();
+	}
+}
+
+} // end namespace swr
@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RenderTarget.h"
+
+namespace swr {
+
+/// File formats written by the image writer.
+enum class ImageFormat {
+	Raw, ///< The pixels in the format of the target, row by row without a header.
+	PPM, ///< Binary PPM, or PGM for float targets.
+	PNG  ///< PNG, compressed with zlib if it was available at build time.
+};
+
+/// Linear copy of the pixels of a render target.
+struct Image {
+	int width;
+	int height;
+	RenderTargetFormat format;
+	std::vector<unsigned char> pixels;
+
+	Image() : width(0), height(0), format(RenderTargetFormat::RGBA8) {}
+
+	/// Copy the pixels of a render target, reusing the existing storage.
+	void assign(const RenderTarget &target);
+
+	/// Size of a row in bytes.
+	int pitch() const { return width * RenderTarget::bytesPerPixel(format); }
+};
+
+/// Write an image to a file.
+/** Color formats are written as 8 bit RGB to PPM and PNG files. Float
+  formats are written as 8 bit gray with [0, 1] mapped to [0, 255].
+  Returns false if the file could not be written. */
+bool writeImage(const Image &image, const std::string &path, ImageFormat format);
+
+/// Write a render target to a file.
+bool writeImage(const RenderTarget &target, const std::string &path, ImageFormat format);
+
+/// Writes images on a background thread.
+/** write() only copies the render target and returns, the file is encoded
+  and written by the writer thread. Image buffers are recycled, so steady
+  state writing does not allocate. */
+class AsyncImageWriter {
+public:
+	/// Constructor.
+	/** At most maxPending images are queued. write() waits for the writer
+	  thread if the queue is full. */
+	explicit AsyncImageWriter(size_t maxPending = 4);
+
+	/// Writes all queued images before returning.
+	~AsyncImageWriter();
+
+	AsyncImageWriter(const AsyncImageWriter&) = delete;
+	AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+	/// Queue a copy of the target to be written to path.
+	void write(const RenderTarget &target, const std::string &path, ImageFormat format);
+
+	/// Wait until all queued images are written.
+	void flush();
+
+	/// Number of images which could not be written so far.
+	size_t failedWrites() const;
+
+private:
+	struct Job {
+		Image image;
+		std::string path;
+		ImageFormat format;
+	};
+
+	void run();
+
+	size_t m_maxPending;
+	std::deque<Job> m_queue;
+	std::vector<Image> m_freeImages;
+	size_t m_pending;
+	size_t m_failed;
+	bool m_stop;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::thread m_thread;
+};
+
+} // end namespace swr
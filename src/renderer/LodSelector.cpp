@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace swr {
+
+namespace {
+
+inline float rowLength(const float *row)
+{
+	return std::sqrt(row[0] * row[0] + row[1] * row[1] + row[2] * row[2]);
+}
+
+} // end anonymous namespace
+
+LodSelector::LodSelector(const VertexProcessor *vertexProcessor, float threshold, float hysteresis)
+	: m_vertexProcessor(vertexProcessor)
+{
+	assert(vertexProcessor != nullptr);
+	setThreshold(threshold);
+	setHysteresis(hysteresis);
+}
+
+void LodSelector::setThreshold(float threshold)
+{
+	assert(threshold > 0.0f);
+	m_threshold = threshold;
+}
+
+void LodSelector::setHysteresis(float hysteresis)
+{
+	assert(hysteresis >= 0.0f && hysteresis < 1.0f);
+	m_hysteresis = hysteresis;
+}
+
+float LodSelector::pixelScale(const BoundingSphere &bounds, const float *clipMatrix) const
+{
+	int x, y, width, height;
+	m_vertexProcessor->getViewport(x, y, width, height);
+
+	// Nearest w of the sphere, the eye distance for perspective projections
+	const float *rowW = clipMatrix + 12;
+	float w = rowW[0] * bounds.center[0] + rowW[1] * bounds.center[1] + rowW[2] * bounds.center[2] + rowW[3];
+	w -= bounds.radius * rowLength(rowW);
+	if (w <= std::numeric_limits<float>::epsilon())
+		return std::numeric_limits<float>::infinity();
+
+	// Clip space units per object space unit in x and y, ignoring the
+	// change of w across the object
+	float scaleX = rowLength(clipMatrix + 0) * 0.5f * width;
+	float scaleY = rowLength(clipMatrix + 4) * 0.5f * height;
+	return std::max(scaleX, scaleY) / w;
+}
+
+size_t LodSelector::select(const LodLevel *levels, size_t levelCount, const BoundingSphere &bounds, const float *clipMatrix,
+	size_t current) const
+{
+	assert(levelCount > 0);
+
+	float scale = pixelScale(bounds, clipMatrix);
+
+	for (size_t i = levelCount - 1; i > 0; --i) {
+		float threshold = m_threshold;
+		if (i > current)
+			threshold *= 1.0f - m_hysteresis;
+		else if (i == current)
+			threshold *= 1.0f + m_hysteresis;
+
+		if (levels[i].error * scale <= threshold)
+			return i;
+	}
+
+	return 0;
+}
+
+} // end namespace swr
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+
+#include "Culling.h"
+#include "MeshSimplifier.h"
+#include "VertexProcessor.h"
+
+namespace swr {
+
+/// Selects levels of detail by their error projected to the screen.
+/** The error of a level, an object space distance from the full detail
+  vertices, is scaled to pixels at the point of the bounding sphere
+  nearest to the eye, with the viewport of a VertexProcessor read at each
+  selection so it follows setViewport(). */
+class LodSelector {
+public:
+	/// Constructor.
+	/** threshold is the largest projected error in pixels. With a
+	  hysteresis above 0 a level coarser than the current one is only
+	  selected when its error is below (1 - hysteresis) times the threshold,
+	  and the current level is kept until its error exceeds
+	  (1 + hysteresis) times the threshold. This keeps objects near a
+	  transition from switching levels every frame. */
+	LodSelector(const VertexProcessor *vertexProcessor, float threshold = 1.0f, float hysteresis = 0.0f);
+
+	/// Set the largest projected error in pixels.
+	void setThreshold(float threshold);
+
+	/// Set the hysteresis as a fraction of the threshold.
+	void setHysteresis(float hysteresis);
+
+	/// Pixels per object space unit at the point of bounds nearest to the eye.
+	/** clipMatrix is the object to clip space transform given as for
+	  Frustum. Returns infinity if the bounds reach the eye plane. */
+	float pixelScale(const BoundingSphere &bounds, const float *clipMatrix) const;
+
+	/// Select a level.
+	/** levels is a chain with increasing errors as built by
+	  buildLodChain(). current is the level selected for the object in the
+	  previous frame. Returns the coarsest level with a small enough
+	  projected error, level 0 if there is none. */
+	size_t select(const LodLevel *levels, size_t levelCount, const BoundingSphere &bounds, const float *clipMatrix,
+		size_t current = 0) const;
+
+private:
+	const VertexProcessor *m_vertexProcessor;
+	float m_threshold;
+	float m_hysteresis;
+};
+
+} // end namespace swr
@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace swr {
+
+// Helpers shared by MeshOptimizer.cpp and MeshSimplifier.cpp, not part of
+// the public interface.
+
+/// Positions with a stride in bytes.
+/** Vec3 is the vector type of the caller, constructed from x, y and z. */
+template <class Vec3>
+class PositionArray {
+public:
+	PositionArray(const float *positions, size_t stride)
+		: m_data(reinterpret_cast<const char*>(positions)), m_stride(stride)
+	{
+	}
+
+	const float *operator()(int index) const
+	{
+		return reinterpret_cast<const float*>(m_data + (size_t)index * m_stride);
+	}
+
+	Vec3 operator[](int index) const
+	{
+		const float *p = (*this)(index);
+		return Vec3(p[0], p[1], p[2]);
+	}
+
+private:
+	const char *m_data;
+	size_t m_stride;
+};
+
+/// Triangles using each vertex, in compressed row form.
+struct Adjacency {
+	std::vector<int> offsets;
+	std::vector<int> triangles;
+
+	Adjacency(const int *indices, size_t indexCount, size_t vertexCount)
+		: offsets(vertexCount + 1, 0), triangles(indexCount)
+	{
+		for (size_t i = 0; i < indexCount; ++i) {
+			assert(indices[i] >= 0 && (size_t)indices[i] < vertexCount);
+			offsets[indices[i] + 1]++;
+		}
+
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] += offsets[v];
+
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			triangles[fill[indices[i]]++] = (int)(i / 3);
+	}
+
+	/// Number of triangles with the directed edge from a to b.
+	int countEdges(const int *indices, int a, int b) const
+	{
+		int count = 0;
+		for (int i = offsets[a]; i < offsets[a + 1]; ++i) {
+			const int *triangle = indices + triangles[i] * 3;
+			for (int k = 0; k < 3; ++k)
+				count += triangle[k] == a && triangle[(k + 1) % 3] == b;
+		}
+		return count;
+	}
+};
+
+} // end namespace swr
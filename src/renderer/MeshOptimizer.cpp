@@ -0,0 +1,713 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MeshOptimizer.h"
+#include "MeshAdjacency.h"
+#include "VertexCache.h"
+#include "VertexProcessor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace swr {
+
+namespace {
+
+const int CacheSize = VertexCache::VertexCacheSize;
+const size_t BatchTriangles = VertexProcessor::BatchPrimitiveCount;
+
+// Size of the depth buffer used by analyzeOverdraw()
+const int OverdrawResolution = 256;
+
+struct Vec3 {
+	float x, y, z;
+
+	Vec3() : x(0.0f), y(0.0f), z(0.0f) {}
+	Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+	Vec3 operator+(const Vec3 &v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+	Vec3 operator-(const Vec3 &v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+	Vec3 operator*(float s) const { return Vec3(x * s, y * s, z * s); }
+};
+
+inline float dot(const Vec3 &a, const Vec3 &b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+	return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline Vec3 normalize(const Vec3 &v)
+{
+	float length = std::sqrt(dot(v, v));
+	return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+// The cache of VertexProcessor in terms of the vertex numbers assigned in
+// the order of first use.
+class CacheModel {
+public:
+	explicit CacheModel(size_t vertexCount)
+		: m_number(vertexCount, -1), m_nextNumber(0)
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < CacheSize; ++i)
+			m_slots[i] = -1;
+	}
+
+	bool contains(int vertex) const
+	{
+		int number = m_number[vertex];
+		return number >= 0 && m_slots[number % CacheSize] == number;
+	}
+
+	// Returns true for a cache miss.
+	bool fetch(int vertex)
+	{
+		if (contains(vertex))
+			return false;
+
+		int &number = m_number[vertex];
+		if (number < 0)
+			number = m_nextNumber++;
+		m_slots[number % CacheSize] = number;
+		return true;
+	}
+
+	// Number of newly numbered vertices which can be fetched before the
+	// vertex is evicted.
+	int remaining(int vertex) const
+	{
+		return ((m_number[vertex] - m_nextNumber) % CacheSize + CacheSize) % CacheSize;
+	}
+
+private:
+	std::vector<int> m_number;
+	int m_nextNumber;
+	int m_slots[CacheSize];
+};
+
+// Tipsify on ranges of triangles. Each range is reordered on its own,
+// starting with the cache state left by the previous ranges.
+class TriangleReorder {
+public:
+	TriangleReorder(const int *indices, size_t triangleCount, size_t vertexCount)
+		: m_indices(indices)
+		, m_adjacency(indices, triangleCount * 3, vertexCount)
+		, m_live(vertexCount, 0)
+		, m_emitted(triangleCount, 0)
+		, m_cache(vertexCount)
+		, m_emittedCount(0)
+	{
+	}
+
+	// Append the triangles begin to end - 1 to result
+	void emit(size_t begin, size_t end, std::vector<int> &result)
+	{
+		if (begin == end)
+			return;
+
+		// Only triangles of the range are live
+		for (size_t i = begin * 3; i < end * 3; ++i)
+			m_live[m_indices[i]]++;
+
+		m_deadEnd.clear();
+		size_t cursor = begin;
+		int fanning = m_indices[begin * 3];
+
+		while (fanning >= 0) {
+			m_candidates.clear();
+
+			// Emit all remaining triangles around the fanning vertex
+			for (int a = m_adjacency.offsets[fanning]; a < m_adjacency.offsets[fanning + 1]; ++a) {
+				size_t triangle = m_adjacency.triangles[a];
+				if (triangle < begin || triangle >= end || m_emitted[triangle])
+					continue;
+
+				m_emitted[triangle] = 1;
+				for (int k = 0; k < 3; ++k) {
+					int v = m_indices[triangle * 3 + k];
+					result.push_back(v);
+					m_cache.fetch(v);
+					m_live[v]--;
+					m_deadEnd.push_back(v);
+					m_candidates.push_back(v);
+				}
+
+				if (++m_emittedCount % BatchTriangles == 0)
+					m_cache.clear();
+			}
+
+			// Continue with the oldest cached vertex whose triangles can all be
+			// emitted before it is evicted
+			fanning = -1;
+			int best = 0;
+			for (size_t c = 0; c < m_candidates.size(); ++c) {
+				int v = m_candidates[c];
+				if (m_live[v] == 0 || !m_cache.contains(v))
+					continue;
+
+				int remaining = m_cache.remaining(v);
+				int priority = 2 * m_live[v] <= remaining ? CacheSize - remaining : 0;
+				if (priority > best) {
+					best = priority;
+					fanning = v;
+				}
+			}
+
+			if (fanning >= 0)
+				continue;
+
+			// Dead end, use a recently seen vertex or the next unfinished one
+			while (!m_deadEnd.empty() && fanning < 0) {
+				int v = m_deadEnd.back();
+				m_deadEnd.pop_back();
+				if (m_live[v] > 0)
+					fanning = v;
+			}
+
+			while (fanning < 0 && cursor < end) {
+				if (!m_emitted[cursor])
+					fanning = m_indices[cursor * 3];
+				else
+					cursor++;
+			}
+		}
+	}
+
+private:
+	const int *m_indices;
+	Adjacency m_adjacency;
+	std::vector<int> m_live;
+	std::vector<char> m_emitted;
+	std::vector<int> m_deadEnd;
+	std::vector<int> m_candidates;
+	CacheModel m_cache;
+	size_t m_emittedCount;
+};
+
+// Copy reordered triangles to destination. Indices which do not form a
+// triangle stay at the end.
+void store(int *destination, const int *indices, size_t indexCount, const std::vector<int> &result)
+{
+	assert(result.size() == indexCount / 3 * 3);
+	memcpy(destination, &result[0], result.size() * sizeof(int));
+
+	if (destination != indices) {
+		for (size_t i = result.size(); i < indexCount; ++i)
+			destination[i] = indices[i];
+	}
+}
+
+// Number of vertices of a triangle missing the cache
+int triangleMisses(VertexCache &cache, const int *triangle, const int *remap)
+{
+	int misses = 0;
+	for (int k = 0; k < 3; ++k) {
+		int index = remap[triangle[k]];
+		if (cache.lookup(index) == -1) {
+			cache.set(index, 0);
+			misses++;
+		}
+	}
+	return misses;
+}
+
+// Draw a triangle list into a depth buffer with an orthographic projection
+// along the view direction.
+void rasterizeOverdraw(const int *indices, size_t triangleCount, const PositionArray<Vec3> &positions, size_t vertexCount,
+	const Vec3 &view, OverdrawStatistics &result)
+{
+	Vec3 right = normalize(cross(view, std::fabs(view.y) < 0.9f ? Vec3(0.0f, 1.0f, 0.0f) : Vec3(1.0f, 0.0f, 0.0f)));
+	Vec3 up = cross(right, view);
+
+	std::vector<Vec3> projected(vertexCount);
+	float minX = std::numeric_limits<float>::max(), maxX = -minX;
+	float minY = minX, maxY = -minX;
+	for (size_t v = 0; v < vertexCount; ++v) {
+		Vec3 p = positions[(int)v];
+		projected[v] = Vec3(dot(p, right), dot(p, up), dot(p, view));
+		minX = std::min(minX, projected[v].x);
+		maxX = std::max(maxX, projected[v].x);
+		minY = std::min(minY, projected[v].y);
+		maxY = std::max(maxY, projected[v].y);
+	}
+
+	float extent = std::max(maxX - minX, maxY - minY);
+	float scale = extent > 0.0f ? OverdrawResolution / extent : 0.0f;
+	for (size_t v = 0; v < vertexCount; ++v) {
+		projected[v].x = (projected[v].x - minX) * scale;
+		projected[v].y = (projected[v].y - minY) * scale;
+	}
+
+	const float cleared = std::numeric_limits<float>::infinity();
+	std::vector<float> depth(OverdrawResolution * OverdrawResolution, cleared);
+
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const Vec3 &v0 = projected[indices[t * 3]];
+		const Vec3 &v1 = projected[indices[t * 3 + 1]];
+		const Vec3 &v2 = projected[indices[t * 3 + 2]];
+
+		// Counter clockwise triangles face the viewer
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		if (area <= 0.0f)
+			continue;
+
+		int x0 = std::max((int)std::floor(std::min(v0.x, std::min(v1.x, v2.x))), 0);
+		int x1 = std::min((int)std::ceil(std::max(v0.x, std::max(v1.x, v2.x))), OverdrawResolution - 1);
+		int y0 = std::max((int)std::floor(std::min(v0.y, std::min(v1.y, v2.y))), 0);
+		int y1 = std::min((int)std::ceil(std::max(v0.y, std::max(v1.y, v2.y))), OverdrawResolution - 1);
+
+		float invArea = 1.0f / area;
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				float px = x + 0.5f, py = y + 0.5f;
+				float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+				float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+				float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+					continue;
+
+				float z = (w0 * v0.z + w1 * v1.z + w2 * v2.z) * invArea;
+				float &stored = depth[y * OverdrawResolution + x];
+				if (z < stored) {
+					stored = z;
+					result.shadedPixels++;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < depth.size(); ++i) {
+		if (depth[i] != cleared)
+			result.coveredPixels++;
+	}
+}
+
+} // end anonymous namespace
+
+VertexCacheStatistics analyzeVertexCache(const int *indices, size_t indexCount, size_t vertexCount)
+{
+	VertexCacheStatistics result;
+	result.vertexCount = 0;
+	result.shadedCount = 0;
+	result.triangleCount = indexCount / 3;
+
+	std::vector<char> used(vertexCount, 0);
+	VertexCache cache;
+
+	for (size_t i = 0; i < result.triangleCount * 3; ++i) {
+		int index = indices[i];
+		assert(index >= 0 && (size_t)index < vertexCount);
+
+		if (!used[index]) {
+			used[index] = 1;
+			result.vertexCount++;
+		}
+
+		if (cache.lookup(index) == -1) {
+			cache.set(index, 0);
+			result.shadedCount++;
+		}
+
+		if ((i + 1) % (BatchTriangles * 3) == 0)
+			cache.clear();
+	}
+
+	result.acmr = result.triangleCount ? (float)result.shadedCount / result.triangleCount : 0.0f;
+	result.atvr = result.vertexCount ? (float)result.shadedCount / result.vertexCount : 0.0f;
+	return result;
+}
+
+void optimizeVertexCache(int *destination, const int *indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	std::vector<int> result;
+	result.reserve(triangleCount * 3);
+
+	TriangleReorder reorder(indices, triangleCount, vertexCount);
+	reorder.emit(0, triangleCount, result);
+
+	store(destination, indices, indexCount, result);
+}
+
+OverdrawStatistics analyzeOverdraw(const int *indices, size_t indexCount, const float *positions, size_t vertexCount, size_t positionStride)
+{
+	OverdrawStatistics result;
+	result.coveredPixels = 0;
+	result.shadedPixels = 0;
+
+	// The axes and the diagonals
+	static const float views[][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 },
+		{ -1, 1, 1 }, { -1, 1, -1 }, { -1, -1, 1 }, { -1, -1, -1 }
+	};
+
+	PositionArray<Vec3> positionArray(positions, positionStride);
+	for (size_t i = 0; i < sizeof(views) / sizeof(views[0]); ++i) {
+		Vec3 view = normalize(Vec3(views[i][0], views[i][1], views[i][2]));
+		rasterizeOverdraw(indices, indexCount / 3, positionArray, vertexCount, view, result);
+	}
+
+	result.overdraw = result.coveredPixels ? (float)result.shadedPixels / result.coveredPixels : 0.0f;
+	return result;
+}
+
+void optimizeOverdraw(int *destination, const int *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t positionStride, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Simulate the cache with the vertex numbers optimizeVertexFetch() assigns
+	std::vector<int> remap(vertexCount);
+	optimizeVertexFetchRemap(&remap[0], indices, triangleCount * 3, vertexCount);
+
+	// A triangle missing the cache with all vertices starts a cluster
+	std::vector<size_t> hardClusters;
+	VertexCache cache;
+	for (size_t t = 0; t < triangleCount; ++t) {
+		if (t % BatchTriangles == 0)
+			cache.clear();
+		if (triangleMisses(cache, indices + t * 3, &remap[0]) == 3 || t == 0)
+			hardClusters.push_back(t);
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Split the clusters further as long as each part, drawn on its own,
+	// stays within threshold of the cache misses of the whole cluster
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+		size_t begin = hardClusters[c], end = hardClusters[c + 1];
+
+		cache.clear();
+		size_t misses = 0;
+		for (size_t t = begin; t < end; ++t)
+			misses += triangleMisses(cache, indices + t * 3, &remap[0]);
+		float limit = threshold * misses / (end - begin);
+
+		cache.clear();
+		clusters.push_back(begin);
+		size_t start = begin;
+		misses = 0;
+		for (size_t t = begin; t + 1 < end; ++t) {
+			misses += triangleMisses(cache, indices + t * 3, &remap[0]);
+			if (misses <= limit * (t + 1 - start)) {
+				start = t + 1;
+				misses = 0;
+				cache.clear();
+				clusters.push_back(start);
+			}
+		}
+
+		// Merge a last part which is worse than the limit with the one before
+		misses += triangleMisses(cache, indices + (end - 1) * 3, &remap[0]);
+		if (start != begin && misses > limit * (end - start))
+			clusters.pop_back();
+	}
+	clusters.push_back(triangleCount);
+	// Area weighted centroid and normal of each cluster
+	PositionArray<Vec3> positionArray(positions, positionStride);
+	size_t clusterCount = clusters.size() - 1;
+	std::vector<Vec3> centroids(clusterCount), normals(clusterCount);
+	Vec3 meshCentroid;
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; ++c) {
+		Vec3 centroid, normal;
+		float area = 0.0f;
+
+		for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+			Vec3 p0 = positionArray[indices[t * 3]];
+			Vec3 p1 = positionArray[indices[t * 3 + 1]];
+			Vec3 p2 = positionArray[indices[t * 3 + 2]];
+
+			Vec3 n = cross(p1 - p0, p2 - p0);
+			float a = std::sqrt(dot(n, n));
+			centroid = centroid + (p0 + p1 + p2) * (a / 3.0f);
+			normal = normal + n;
+			area += a;
+		}
+
+		meshCentroid = meshCentroid + centroid;
+		meshArea += area;
+		centroids[c] = area > 0.0f ? centroid * (1.0f / area) : positionArray[indices[clusters[c] * 3]];
+		normals[c] = normalize(normal);
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid = meshCentroid * (1.0f / meshArea);
+
+	// Clusters facing away from the center first
+	std::vector<float> keys(clusterCount);
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c) {
+		keys[c] = dot(centroids[c] - meshCentroid, normals[c]);
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	// Reorder the triangles within each cluster again, as vertices shared
+	// with clusters drawn earlier now use other cache entries
+	std::vector<int> result;
+	result.reserve(triangleCount * 3);
+
+	TriangleReorder reorder(indices, triangleCount, vertexCount);
+	for (size_t i = 0; i < clusterCount; ++i)
+		reorder.emit(clusters[order[i]], clusters[order[i] + 1], result);
+
+	store(destination, indices, indexCount, result);
+}
+
+void buildMeshlets(std::vector<Meshlet> &meshlets, int *destination, const int *indices, size_t indexCount,
+	const float *positions, size_t vertexCount, size_t positionStride, size_t maxTriangles)
+{
+	assert(maxTriangles > 0);
+
+	meshlets.clear();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	PositionArray<Vec3> positionArray(positions, positionStride);
+	Adjacency adjacency(indices, triangleCount * 3, vertexCount);
+
+	std::vector<Vec3> normals(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		Vec3 p0 = positionArray[indices[t * 3]];
+		Vec3 p1 = positionArray[indices[t * 3 + 1]];
+		Vec3 p2 = positionArray[indices[t * 3 + 2]];
+		normals[t] = normalize(cross(p1 - p0, p2 - p0));
+	}
+
+	// Group the triangles of each meshlet
+	std::vector<char> assigned(triangleCount, 0);
+	std::vector<int> vertexMeshlet(vertexCount, -1);
+	std::vector<int> candidates;
+	std::vector<int> grouped;
+	std::vector<size_t> ranges;
+	grouped.reserve(triangleCount * 3);
+
+	size_t seed = 0;
+	for (;;) {
+		while (seed < triangleCount && assigned[seed])
+			seed++;
+		if (seed == triangleCount)
+			break;
+
+		int id = (int)ranges.size();
+		ranges.push_back(grouped.size() / 3);
+		candidates.clear();
+
+		Vec3 normalSum;
+		Vec3 lower = positionArray[indices[seed * 3]], upper = lower;
+		size_t count = 0;
+		int next = (int)seed;
+
+		while (next >= 0) {
+			assigned[next] = 1;
+			normalSum = normalSum + normals[next];
+
+			for (int k = 0; k < 3; ++k) {
+				int v = indices[next * 3 + k];
+				grouped.push_back(v);
+
+				Vec3 p = positionArray[v];
+				lower = Vec3(std::min(lower.x, p.x), std::min(lower.y, p.y), std::min(lower.z, p.z));
+				upper = Vec3(std::max(upper.x, p.x), std::max(upper.y, p.y), std::max(upper.z, p.z));
+
+				if (vertexMeshlet[v] != id) {
+					vertexMeshlet[v] = id;
+					for (int a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; ++a) {
+						if (!assigned[adjacency.triangles[a]])
+							candidates.push_back(adjacency.triangles[a]);
+					}
+				}
+			}
+
+			if (++count == maxTriangles)
+				break;
+
+			// Prefer triangles sharing more vertices, then similar normals
+			Vec3 axis = normalize(normalSum);
+			float best = -2.0f;
+			size_t kept = 0;
+			next = -1;
+
+			for (size_t c = 0; c < candidates.size(); ++c) {
+				int t = candidates[c];
+				if (assigned[t])
+					continue;
+				candidates[kept++] = t;
+
+				int shared = 0;
+				for (int k = 0; k < 3; ++k)
+					shared += vertexMeshlet[indices[t * 3 + k]] == id;
+
+				float score = shared + dot(normals[t], axis);
+				if (score > best) {
+					best = score;
+					next = t;
+				}
+			}
+
+			candidates.resize(kept);
+
+			// Without neighbours, for example at split vertices along hard
+			// edges, continue with the next triangle in index order if it is
+			// close to the meshlet
+			if (next < 0) {
+				while (seed < triangleCount && assigned[seed])
+					seed++;
+
+				if (seed < triangleCount) {
+					Vec3 center = (lower + upper) * 0.5f;
+					Vec3 extent = upper - lower;
+					Vec3 p0 = positionArray[indices[seed * 3]];
+					Vec3 p1 = positionArray[indices[seed * 3 + 1]];
+					Vec3 p2 = positionArray[indices[seed * 3 + 2]];
+					Vec3 d = (p0 + p1 + p2) * (1.0f / 3.0f) - center;
+					if (dot(d, d) <= dot(extent, extent))
+						next = (int)seed;
+				}
+			}
+		}
+	}
+
+	ranges.push_back(triangleCount);
+
+	std::vector<int> result;
+	result.reserve(triangleCount * 3);
+
+	TriangleReorder reorder(&grouped[0], triangleCount, vertexCount);
+	for (size_t m = 0; m + 1 < ranges.size(); ++m)
+		reorder.emit(ranges[m], ranges[m + 1], result);
+
+	// Bounding sphere around the bounding box and the normal cone
+	std::vector<Vec3> triangleNormals;
+	meshlets.resize(ranges.size() - 1);
+	for (size_t m = 0; m < meshlets.size(); ++m) {
+		Meshlet &meshlet = meshlets[m];
+		meshlet.firstIndex = (unsigned)(ranges[m] * 3);
+		meshlet.triangleCount = (unsigned)(ranges[m + 1] - ranges[m]);
+
+		const int *first = &result[meshlet.firstIndex];
+		const int *last = first + meshlet.triangleCount * 3;
+
+		Vec3 lower = positionArray[first[0]], upper = lower;
+		for (const int *i = first; i != last; ++i) {
+			Vec3 p = positionArray[*i];
+			lower = Vec3(std::min(lower.x, p.x), std::min(lower.y, p.y), std::min(lower.z, p.z));
+			upper = Vec3(std::max(upper.x, p.x), std::max(upper.y, p.y), std::max(upper.z, p.z));
+		}
+
+		Vec3 center = (lower + upper) * 0.5f;
+		float radius = 0.0f;
+		for (const int *i = first; i != last; ++i) {
+			Vec3 d = positionArray[*i] - center;
+			radius = std::max(radius, dot(d, d));
+		}
+
+		triangleNormals.clear();
+		Vec3 normalSum;
+		for (const int *i = first; i != last; i += 3) {
+			Vec3 p0 = positionArray[i[0]];
+			Vec3 n = normalize(cross(positionArray[i[1]] - p0, positionArray[i[2]] - p0));
+			if (dot(n, n) > 0.0f) {
+				triangleNormals.push_back(n);
+				normalSum = normalSum + n;
+			}
+		}
+
+		Vec3 axis = normalize(normalSum);
+		float minDot = dot(axis, axis) > 0.0f ? 1.0f : -1.0f;
+		for (size_t n = 0; n < triangleNormals.size(); ++n)
+			minDot = std::min(minDot, dot(triangleNormals[n], axis));
+
+		meshlet.bounds.center[0] = center.x;
+		meshlet.bounds.center[1] = center.y;
+		meshlet.bounds.center[2] = center.z;
+		meshlet.bounds.radius = std::sqrt(radius);
+		meshlet.coneAxis[0] = axis.x;
+		meshlet.coneAxis[1] = axis.y;
+		meshlet.coneAxis[2] = axis.z;
+		// Widened a little against rounding of nearly coplanar triangles
+		meshlet.coneCutoff = minDot > 0.0f ? std::min(std::sqrt(1.0f - minDot * minDot) + 0.001f, 1.0f) : 1.0f;
+	}
+
+	store(destination, indices, indexCount, result);
+}
+
+size_t optimizeVertexFetchRemap(int *remap, const int *indices, size_t indexCount, size_t vertexCount)
+{
+	for (size_t v = 0; v < vertexCount; ++v)
+		remap[v] = -1;
+
+	int next = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		int index = indices[i];
+		assert(index >= 0 && (size_t)index < vertexCount);
+		if (remap[index] == -1)
+			remap[index] = next++;
+	}
+
+	return (size_t)next;
+}
+
+void remapIndexBuffer(int *destination, const int *indices, size_t indexCount, const int *remap)
+{
+	for (size_t i = 0; i < indexCount; ++i) {
+		assert(remap[indices[i]] != -1);
+		destination[i] = remap[indices[i]];
+	}
+}
+
+void remapVertexBuffer(void *destination, const void *vertices, size_t vertexCount, size_t vertexSize, const int *remap)
+{
+	char *dst = static_cast<char*>(destination);
+	const char *src = static_cast<const char*>(vertices);
+
+	for (size_t v = 0; v < vertexCount; ++v) {
+		if (remap[v] != -1)
+			memcpy(dst + (size_t)remap[v] * vertexSize, src + v * vertexSize, vertexSize);
+	}
+}
+
+} // end namespace swr
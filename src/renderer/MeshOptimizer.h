@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <vector>
+
+#include "Culling.h"
+
+namespace swr {
+
+/// Vertex cache efficiency of a triangle list.
+struct VertexCacheStatistics {
+	size_t vertexCount;   ///< Vertices referenced by the indices.
+	size_t shadedCount;   ///< Vertices shaded by VertexProcessor::drawElements().
+	size_t triangleCount;
+	float acmr;           ///< Average cache miss ratio, shaded vertices per triangle.
+	float atvr;           ///< Shaded vertices per referenced vertex, 1 is optimal.
+};
+
+/// Simulate the vertex cache of VertexProcessor for a triangle list.
+/** Uses the same direct mapped cache and the same batches as
+  VertexProcessor::drawElements(). */
+VertexCacheStatistics analyzeVertexCache(const int *indices, size_t indexCount, size_t vertexCount);
+
+/// Reorder the triangles of a triangle list for the vertex cache.
+/** This is Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+  Locality and Reduced Overdraw") with the exact cache of VertexProcessor
+  instead of a FIFO. As that cache is direct mapped on the vertex index,
+  the order is chosen for vertices numbered in the order of their first
+  use, so apply optimizeVertexFetch() afterwards. destination may be equal
+  to indices. */
+void optimizeVertexCache(int *destination, const int *indices, size_t indexCount, size_t vertexCount);
+
+/// Compute a vertex order for fetch locality.
+/** Vertices are numbered in the order of their first use in the indices.
+  remap receives the new index for each of the vertexCount vertices, or
+  -1 for unreferenced vertices. Returns the number of referenced vertices. */
+size_t optimizeVertexFetchRemap(int *remap, const int *indices, size_t indexCount, size_t vertexCount);
+
+/// Replace each index by its remapped index.
+/** destination may be equal to indices. */
+void remapIndexBuffer(int *destination, const int *indices, size_t indexCount, const int *remap);
+
+/// Move each vertex to its remapped position.
+/** Vertices with a remap of -1 are dropped. destination must hold the
+  number of referenced vertices and must not overlap vertices. */
+void remapVertexBuffer(void *destination, const void *vertices, size_t vertexCount, size_t vertexSize, const int *remap);
+
+/// Overdraw of a triangle list.
+struct OverdrawStatistics {
+	size_t coveredPixels; ///< Pixels covered by the mesh, summed over all views.
+	size_t shadedPixels;  ///< Pixels passing an early depth test when drawn in order.
+	float overdraw;       ///< Shaded pixels per covered pixel, 1 is optimal.
+};
+
+/// Measure the overdraw of a triangle list.
+/** The mesh is rasterized with a depth test from a fixed set of view
+  directions around it. Clockwise triangles are culled like with the
+  default CullMode::CW. positions points to the x coordinate of the first
+  vertex, followed by y and z, positionStride is the size of a vertex in
+  bytes. */
+OverdrawStatistics analyzeOverdraw(const int *indices, size_t indexCount, const float *positions, size_t vertexCount, size_t positionStride);
+
+/// Reorder the triangles of a triangle list for less overdraw.
+/** Expects indices optimized by optimizeVertexCache(). The triangles are
+  split into clusters which keep the vertex cache misses within threshold
+  times those of the input. The clusters are sorted so those facing away
+  from the center of the mesh come first, as they tend to occlude the
+  others from any direction (Sander et al., "Fast Triangle Reordering for
+  Vertex Locality and Reduced Overdraw"). destination may be equal to
+  indices. */
+void optimizeOverdraw(int *destination, const int *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t positionStride, float threshold = 1.05f);
+
+/// Split a triangle list into meshlets for culling.
+/** Meshlets are grown from seed triangles in index order over triangles
+  sharing vertices with them, preferring those sharing more vertices and
+  with normals close to the meshlet's, until they have maxTriangles
+  triangles. The triangles are written to destination so that each
+  meshlet is a contiguous range, ordered for the vertex cache. Works best
+  on indices optimized by optimizeVertexCache(). destination may be equal
+  to indices. See VertexProcessor::drawMeshlets(). */
+void buildMeshlets(std::vector<Meshlet> &meshlets, int *destination, const int *indices, size_t indexCount,
+	const float *positions, size_t vertexCount, size_t positionStride, size_t maxTriangles = 128);
+
+/// Reorder vertices by first use and remove unreferenced vertices.
+template <class Vertex>
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	if (indices.empty())
+		return;
+
+	std::vector<int> remap(vertices.size());
+	size_t count = optimizeVertexFetchRemap(&remap[0], &indices[0], indices.size(), vertices.size());
+	remapIndexBuffer(&indices[0], &indices[0], indices.size(), &remap[0]);
+
+	std::vector<Vertex> result(count);
+	remapVertexBuffer(&result[0], &vertices[0], vertices.size(), sizeof(Vertex), &remap[0]);
+	vertices.swap(result);
+}
+
+/// Reorder a triangle list and its vertices for the vertex cache.
+/** Runs optimizeVertexCache() and optimizeVertexFetch(). */
+template <class Vertex>
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	if (indices.empty())
+		return;
+
+	optimizeVertexCache(&indices[0], &indices[0], indices.size(), vertices.size());
+	optimizeVertexFetch(vertices, indices);
+}
+
+/// Reorder a triangle list and its vertices for the vertex cache and overdraw.
+/** Runs optimizeVertexCache(), optimizeOverdraw() and optimizeVertexFetch().
+  position is the member of Vertex holding the x, y and z coordinates, for
+  example &ObjData::VertexArrayData::vertex. */
+template <class Vertex, class Position>
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<int> &indices, Position Vertex::*position, float threshold = 1.05f)
+{
+	static_assert(sizeof(Position) >= 3 * sizeof(float), "position needs three floats");
+
+	if (indices.empty())
+		return;
+
+	const float *positions = reinterpret_cast<const float*>(&(vertices[0].*position));
+	optimizeVertexCache(&indices[0], &indices[0], indices.size(), vertices.size());
+	optimizeOverdraw(&indices[0], &indices[0], indices.size(), positions, vertices.size(), sizeof(Vertex), threshold);
+	optimizeVertexFetch(vertices, indices);
+}
+
+} // end namespace swr
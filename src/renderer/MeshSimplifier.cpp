@@ -0,0 +1,566 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MeshSimplifier.h"
+#include "MeshAdjacency.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace swr {
+
+namespace {
+
+// Weight of the planes keeping open borders in place, relative to the
+// planes of the triangles.
+const double BorderWeight = 10.0;
+
+struct Vec3 {
+	double x, y, z;
+
+	Vec3() : x(0.0), y(0.0), z(0.0) {}
+	Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+
+	Vec3 operator+(const Vec3 &v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
+	Vec3 operator-(const Vec3 &v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
+	Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+};
+
+inline double dot(const Vec3 &a, const Vec3 &b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+	return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// Weighted sum of squared distances to planes
+struct Quadric {
+	double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+	double weight;
+
+	Quadric()
+		: a2(0.0), b2(0.0), c2(0.0), ab(0.0), ac(0.0), bc(0.0), ad(0.0), bd(0.0), cd(0.0), d2(0.0), weight(0.0)
+	{
+	}
+
+	// The plane is dot(normal, p) + d = 0 with a unit normal
+	void addPlane(const Vec3 &normal, double d, double w)
+	{
+		a2 += w * normal.x * normal.x;
+		b2 += w * normal.y * normal.y;
+		c2 += w * normal.z * normal.z;
+		ab += w * normal.x * normal.y;
+		ac += w * normal.x * normal.z;
+		bc += w * normal.y * normal.z;
+		ad += w * normal.x * d;
+		bd += w * normal.y * d;
+		cd += w * normal.z * d;
+		d2 += w * d * d;
+		weight += w;
+	}
+
+	void add(const Quadric &q)
+	{
+		a2 += q.a2; b2 += q.b2; c2 += q.c2;
+		ab += q.ab; ac += q.ac; bc += q.bc;
+		ad += q.ad; bd += q.bd; cd += q.cd;
+		d2 += q.d2;
+		weight += q.weight;
+	}
+
+	// Mean squared distance of p to the planes
+	double evaluate(const Vec3 &p) const
+	{
+		if (weight <= 0.0)
+			return 0.0;
+
+		double sum = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z
+			+ 2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z)
+			+ 2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+		return std::max(sum, 0.0) / weight;
+	}
+};
+
+// Distance of p to the segment from a to b
+double distanceToSegment(const Vec3 &p, const Vec3 &a, const Vec3 &b)
+{
+	Vec3 edge = b - a;
+	double length2 = dot(edge, edge);
+	double t = length2 > 0.0 ? std::min(std::max(dot(p - a, edge) / length2, 0.0), 1.0) : 0.0;
+	Vec3 offset = p - (a + edge * t);
+	return std::sqrt(dot(offset, offset));
+}
+
+// Distance of p to the triangle a, b, c
+double distanceToTriangle(const Vec3 &p, const Vec3 &a, const Vec3 &b, const Vec3 &c)
+{
+	Vec3 normal = cross(b - a, c - a);
+	double length2 = dot(normal, normal);
+	if (length2 > 0.0) {
+		double height = dot(p - a, normal) / length2;
+		Vec3 q = p - normal * height;
+		if (dot(cross(b - a, q - a), normal) >= 0.0 && dot(cross(c - b, q - b), normal) >= 0.0
+			&& dot(cross(a - c, q - c), normal) >= 0.0)
+			return std::fabs(height) * std::sqrt(length2);
+	}
+	return std::min(distanceToSegment(p, a, b), std::min(distanceToSegment(p, b, c), distanceToSegment(p, c, a)));
+}
+
+// Triangle around the target of a collapse
+struct FanTriangle {
+	Vec3 a, b, c;
+	Vec3 normal; // Zero if the triangle is degenerate
+	int indices[3];
+};
+
+// Collect the triangles around target after collapsing v onto it. The
+// triangles around both become degenerate and are left out.
+void collectFan(std::vector<FanTriangle> &fan, int v, int target, const int *indices, const Adjacency &adjacency,
+	const PositionArray<Vec3> &positions)
+{
+	fan.clear();
+	int centers[2] = { v, target };
+	for (int center : centers) {
+		for (int i = adjacency.offsets[center]; i < adjacency.offsets[center + 1]; ++i) {
+			const int *triangle = indices + adjacency.triangles[i] * 3;
+			int a = triangle[0] == v ? target : triangle[0];
+			int b = triangle[1] == v ? target : triangle[1];
+			int c = triangle[2] == v ? target : triangle[2];
+			if (a == b || b == c || a == c)
+				continue;
+
+			FanTriangle f;
+			f.indices[0] = a;
+			f.indices[1] = b;
+			f.indices[2] = c;
+			f.a = positions[a];
+			f.b = positions[b];
+			f.c = positions[c];
+			f.normal = cross(f.b - f.a, f.c - f.a);
+			double length = std::sqrt(dot(f.normal, f.normal));
+			if (length > 0.0)
+				f.normal = f.normal * (1.0 / length);
+			fan.push_back(f);
+		}
+	}
+}
+
+// Distance of p to the nearest triangle of fan, whose position is stored
+// in nearestTriangle. Infinite if fan is empty.
+double distanceToFan(const Vec3 &p, const std::vector<FanTriangle> &fan, size_t &nearestTriangle)
+{
+	double nearest = std::numeric_limits<double>::infinity();
+	for (size_t i = 0; i < fan.size(); ++i) {
+		// The distance to the plane is a lower bound
+		const FanTriangle &triangle = fan[i];
+		if (std::fabs(dot(p - triangle.a, triangle.normal)) >= nearest)
+			continue;
+
+		double distance = distanceToTriangle(p, triangle.a, triangle.b, triangle.c);
+		if (distance < nearest) {
+			nearest = distance;
+			nearestTriangle = i;
+		}
+	}
+	return nearest;
+}
+
+enum VertexKind : unsigned char {
+	Manifold, // Moves anywhere
+	Border,   // Moves along open borders
+	Locked    // Never moves
+};
+
+// New owner of a vertex measured for a collapse
+struct PointMove {
+	int point;
+	int owner;
+	int triangle; // Position in the fan, -1 if the nearest triangle is kept
+};
+
+struct Collapse {
+	int vertex;
+	int target;
+	double cost;
+};
+
+// Classify the vertices and sum the quadrics of their triangles and borders.
+void analyzeMesh(std::vector<unsigned char> &kinds, std::vector<Quadric> &quadrics, const int *indices, size_t indexCount,
+	const PositionArray<Vec3> &positions, size_t vertexCount)
+{
+	kinds.assign(vertexCount, Manifold);
+	quadrics.assign(vertexCount, Quadric());
+
+	// Vertices sharing their position with others are on attribute seams
+	std::vector<int> order(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		order[v] = (int)v;
+
+	std::sort(order.begin(), order.end(), [&](int a, int b) {
+		const float *pa = positions(a);
+		const float *pb = positions(b);
+		return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+	});
+
+	for (size_t i = 1; i < vertexCount; ++i) {
+		const float *pa = positions(order[i - 1]);
+		const float *pb = positions(order[i]);
+		if (pa[0] == pb[0] && pa[1] == pb[1] && pa[2] == pb[2])
+			kinds[order[i - 1]] = kinds[order[i]] = Locked;
+	}
+
+	Adjacency adjacency(indices, indexCount, vertexCount);
+
+	for (size_t i = 0; i < indexCount; i += 3) {
+		const int *triangle = indices + i;
+		Vec3 p0 = positions[triangle[0]];
+		Vec3 normal = cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+		double length = std::sqrt(dot(normal, normal));
+		if (length == 0.0)
+			continue;
+
+		normal = normal * (1.0 / length);
+		for (int k = 0; k < 3; ++k)
+			quadrics[triangle[k]].addPlane(normal, -dot(normal, p0), 0.5 * length);
+
+		for (int k = 0; k < 3; ++k) {
+			int a = triangle[k];
+			int b = triangle[(k + 1) % 3];
+			int opposite = adjacency.countEdges(indices, b, a);
+
+			if (opposite > 1 || adjacency.countEdges(indices, a, b) > 1) {
+				kinds[a] = kinds[b] = Locked;
+			} else if (opposite == 0) {
+				if (kinds[a] == Manifold)
+					kinds[a] = Border;
+				if (kinds[b] == Manifold)
+					kinds[b] = Border;
+
+				// Plane through the edge perpendicular to the triangle
+				Vec3 pa = positions[a];
+				Vec3 edge = positions[b] - pa;
+				Vec3 side = cross(edge, normal);
+				double sideLength = std::sqrt(dot(side, side));
+				if (sideLength > 0.0) {
+					side = side * (1.0 / sideLength);
+					double w = dot(edge, edge) * BorderWeight;
+					quadrics[a].addPlane(side, -dot(side, pa), w);
+					quadrics[b].addPlane(side, -dot(side, pa), w);
+				}
+			}
+		}
+	}
+}
+
+// The quadrics only rank the collapses, their mean squared distance
+// underestimates the largest one. Each input vertex remembers the three
+// indices of its nearest triangle and is owned by one of them. The owners
+// keep their vertices in linked lists. Only collapses changing the
+// nearest triangle need to measure a vertex again.
+struct PointLists {
+	std::vector<int> first, last, next;
+	std::vector<int> nearest; // -1 until the vertex is seen in a triangle
+
+	explicit PointLists(size_t vertexCount)
+		: first(vertexCount), last(vertexCount), next(vertexCount, -1), nearest(vertexCount * 3, -1)
+	{
+		for (size_t v = 0; v < vertexCount; ++v)
+			first[v] = last[v] = (int)v;
+	}
+
+	void append(int owner, int point)
+	{
+		if (first[owner] < 0)
+			first[owner] = point;
+		else
+			next[last[owner]] = point;
+		last[owner] = point;
+		next[point] = -1;
+	}
+};
+
+// See simplify(). maxDistance is raised to the largest distance of the
+// vertices in points from their nearest triangles.
+size_t simplifyMesh(int *destination, const int *indices, size_t indexCount, const PositionArray<Vec3> &positionArray,
+	size_t vertexCount, size_t targetIndexCount, float targetError, PointLists &points, double &maxDistance)
+{
+	std::vector<int> result(indices, indices + indexCount);
+
+	if (indexCount > 0 && indexCount > targetIndexCount) {
+		std::vector<unsigned char> kinds;
+		std::vector<Quadric> quadrics;
+		analyzeMesh(kinds, quadrics, &result[0], indexCount, positionArray, vertexCount);
+
+		double maxCost = (double)targetError * targetError;
+		std::vector<Collapse> collapses;
+		std::vector<int> remap(vertexCount);
+		std::vector<unsigned char> touched(vertexCount);
+		std::vector<int> ring;
+		std::vector<PointMove> moves;
+		std::vector<FanTriangle> fan;
+
+		// Vertices not measured yet own themselves and lie on their triangles
+		for (size_t i = 0; i < indexCount; ++i) {
+			int *nearest = &points.nearest[result[i] * 3];
+			if (nearest[0] < 0)
+				std::copy(&result[i - i % 3], &result[i - i % 3] + 3, nearest);
+		}
+
+		while (result.size() > targetIndexCount) {
+			const int *current = &result[0];
+			Adjacency adjacency(current, result.size(), vertexCount);
+
+			// The cheapest collapse of each vertex onto a neighbour
+			collapses.clear();
+			for (size_t v = 0; v < vertexCount; ++v) {
+				if (kinds[v] == Locked)
+					continue;
+
+				Collapse best = { (int)v, -1, maxCost };
+				for (int i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i) {
+					const int *triangle = current + adjacency.triangles[i] * 3;
+					for (int k = 0; k < 3; ++k) {
+						int target = triangle[k];
+						if (target == (int)v)
+							continue;
+
+						if (kinds[v] == Border && adjacency.countEdges(current, (int)v, target) != 0
+							&& adjacency.countEdges(current, target, (int)v) != 0)
+							continue;
+
+						Quadric q = quadrics[v];
+						q.add(quadrics[target]);
+						double cost = q.evaluate(positionArray[target]);
+						if (cost <= best.cost && (cost < best.cost || best.target < 0)) {
+							best.target = target;
+							best.cost = cost;
+						}
+					}
+				}
+
+				if (best.target >= 0)
+					collapses.push_back(best);
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+				return a.cost < b.cost || (a.cost == b.cost && a.vertex < b.vertex);
+			});
+
+			// Most collapses remove two triangles. Only do about as many
+			// as needed this pass, so the next pass sees the updated costs.
+			size_t triangleCount = result.size() / 3;
+			size_t targetTriangles = targetIndexCount / 3;
+			size_t goal = std::max<size_t>((triangleCount - targetTriangles) / 2, 1);
+			double passCost = collapses[std::min(goal, collapses.size()) - 1].cost;
+
+			for (size_t v = 0; v < vertexCount; ++v)
+				remap[v] = (int)v;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			size_t collapseCount = 0;
+			for (const Collapse &collapse : collapses) {
+				if (collapse.cost > passCost || triangleCount <= targetTriangles)
+					break;
+
+				int v = collapse.vertex;
+				if (touched[v] || touched[collapse.target])
+					continue;
+
+				// Skip collapses which would flip triangles
+				Vec3 from = positionArray[v];
+				Vec3 to = positionArray[collapse.target];
+				size_t removed = 0;
+				bool flips = false;
+
+				for (int i = adjacency.offsets[v]; i < adjacency.offsets[v + 1] && !flips; ++i) {
+					const int *triangle = current + adjacency.triangles[i] * 3;
+					if (triangle[0] == collapse.target || triangle[1] == collapse.target || triangle[2] == collapse.target) {
+						removed++;
+						continue;
+					}
+
+					int k = triangle[0] == v ? 0 : triangle[1] == v ? 1 : 2;
+					Vec3 p1 = positionArray[triangle[(k + 1) % 3]];
+					Vec3 p2 = positionArray[triangle[(k + 2) % 3]];
+					Vec3 before = cross(p1 - from, p2 - from);
+					Vec3 after = cross(p1 - to, p2 - to);
+					flips = dot(before, after) <= 0.0;
+				}
+
+				if (flips)
+					continue;
+
+				// The nearest triangles of vertices owned by the vertices of
+				// the triangles around v may change. Those move to target and
+				// the nearest of its triangles after the collapse.
+				collectFan(fan, v, collapse.target, current, adjacency, positionArray);
+				if (fan.empty())
+					continue;
+
+				ring.clear();
+				for (int i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i) {
+					const int *triangle = current + adjacency.triangles[i] * 3;
+					for (int k = 0; k < 3; ++k) {
+						if (std::find(ring.begin(), ring.end(), triangle[k]) == ring.end())
+							ring.push_back(triangle[k]);
+					}
+				}
+
+				double distance = 0.0;
+				moves.clear();
+				for (int w : ring) {
+					for (int point = points.first[w]; point >= 0 && distance <= targetError; point = points.next[point]) {
+						const int *nearest = &points.nearest[point * 3];
+						PointMove move = { point, w, -1 };
+						if (nearest[0] == v || nearest[1] == v || nearest[2] == v) {
+							size_t triangle = 0;
+							distance = std::max(distance, distanceToFan(positionArray[point], fan, triangle));
+							move.owner = collapse.target;
+							move.triangle = (int)triangle;
+						}
+						moves.push_back(move);
+					}
+				}
+
+				if (distance > targetError)
+					continue;
+
+				remap[v] = collapse.target;
+				quadrics[collapse.target].add(quadrics[v]);
+				maxDistance = std::max(maxDistance, distance);
+
+				for (int w : ring)
+					points.first[w] = -1;
+				for (const PointMove &move : moves) {
+					points.append(move.owner, move.point);
+					if (move.triangle >= 0)
+						std::copy(fan[move.triangle].indices, fan[move.triangle].indices + 3, &points.nearest[move.point * 3]);
+				}
+				triangleCount -= std::min(removed, triangleCount);
+				collapseCount++;
+
+				// Leave the changed triangles to the next pass
+				for (int w : ring)
+					touched[w] = 1;
+			}
+
+			if (collapseCount == 0)
+				break;
+
+			// Remove the triangles which became degenerate
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				int a = remap[result[i + 0]];
+				int b = remap[result[i + 1]];
+				int c = remap[result[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+
+			if (result.empty())
+				break;
+		}
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	return result.size();
+}
+
+} // end anonymous namespace
+
+size_t simplify(int *destination, const int *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t positionStride, size_t targetIndexCount, float targetError, float *resultError)
+{
+	assert(indexCount % 3 == 0);
+
+	PointLists points(vertexCount);
+	double maxDistance = 0.0;
+	size_t count = simplifyMesh(destination, indices, indexCount, PositionArray<Vec3>(positions, positionStride), vertexCount,
+		targetIndexCount, targetError, points, maxDistance);
+
+	if (resultError)
+		*resultError = (float)maxDistance;
+
+	return count;
+}
+
+void buildLodChain(std::vector<LodLevel> &levels, std::vector<int> &lodIndices, const int *indices, size_t indexCount,
+	const float *positions, size_t vertexCount, size_t positionStride, size_t maxLevels, float reduction, float maxError)
+{
+	assert(indexCount % 3 == 0);
+	assert(reduction > 0.0f && reduction < 1.0f);
+
+	levels.clear();
+	lodIndices.clear();
+	if (indexCount == 0 || maxLevels == 0)
+		return;
+
+	lodIndices.assign(indices, indices + indexCount);
+	optimizeVertexCache(&lodIndices[0], &lodIndices[0], indexCount, vertexCount);
+
+	LodLevel level = { 0, (unsigned)indexCount, 0.0f };
+	levels.push_back(level);
+
+	// The vertices keep their owners from level to level, so every level
+	// is measured against the input
+	PositionArray<Vec3> positionArray(positions, positionStride);
+	PointLists points(vertexCount);
+	double maxDistance = 0.0;
+
+	std::vector<int> simplified(indexCount);
+	while (levels.size() < maxLevels) {
+		LodLevel previous = levels.back();
+		size_t target = (size_t)(previous.indexCount / 3 * reduction) * 3;
+
+		size_t count = simplifyMesh(&simplified[0], &lodIndices[previous.firstIndex], previous.indexCount, positionArray,
+			vertexCount, target, maxError, points, maxDistance);
+
+		// Stop when a level would save less than a tenth of the triangles
+		if (count == 0 || count * 10 > (size_t)previous.indexCount * 9)
+			break;
+
+		optimizeVertexCache(&simplified[0], &simplified[0], count, vertexCount);
+
+		level.firstIndex = (unsigned)lodIndices.size();
+		level.indexCount = (unsigned)count;
+		level.error = (float)maxDistance;
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.begin() + count);
+		levels.push_back(level);
+	}
+}
+
+} // end namespace swr
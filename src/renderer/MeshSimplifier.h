@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "MeshOptimizer.h"
+
+namespace swr {
+
+/// Simplify a triangle list by collapsing edges.
+/** Ranks collapses by quadric error metrics (Garland and Heckbert,
+  "Surface Simplification Using Quadric Error Metrics"). Each collapse
+  moves a vertex onto one of its neighbours, so the result indexes the
+  input vertices and all their attributes stay valid. The cheapest
+  collapses are done first until at most targetIndexCount indices remain.
+  Collapses which would leave an input vertex further than targetError
+  from the simplified triangles, a distance in object space, are skipped.
+  Vertices sharing their position with another vertex, like those on
+  texture seams, and vertices on non-manifold edges are never moved.
+  Vertices on open borders only move along the border. If resultError is
+  not nullptr it receives an upper bound of the largest distance of an
+  input vertex from the triangles of the result. Points between the input
+  vertices may be further away. Returns the number of indices written to
+  destination, which may be equal to indices. */
+size_t simplify(int *destination, const int *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t positionStride, size_t targetIndexCount, float targetError = std::numeric_limits<float>::max(),
+	float *resultError = nullptr);
+
+/// Level of detail as a range of an index buffer.
+struct LodLevel {
+	unsigned firstIndex; ///< Position of the first index in the index buffer.
+	unsigned indexCount;
+	float error;         ///< Bound of the object space distance of the input vertices from the level.
+};
+
+/// Build a chain of levels of detail.
+/** Level 0 is the input, each following level is simplified from the
+  previous one to about reduction times its triangles, with its error
+  measured against the input as in simplify(). The chain ends after
+  maxLevels levels, when the error would exceed maxError or when
+  simplification stalls. The indices of all levels are written one after
+  the other to lodIndices, each optimized for the vertex cache. See
+  simplify() and LodSelector. */
+void buildLodChain(std::vector<LodLevel> &levels, std::vector<int> &lodIndices, const int *indices, size_t indexCount,
+	const float *positions, size_t vertexCount, size_t positionStride, size_t maxLevels = 8, float reduction = 0.5f,
+	float maxError = std::numeric_limits<float>::max());
+
+/// Build a chain of levels of detail for a mesh.
+/** Replaces indices by the indices of all levels and reorders the
+  vertices for fetch locality. position is the member of Vertex holding
+  the x, y and z coordinates, for example &ObjData::VertexArrayData::vertex.
+  See buildLodChain(). */
+template <class Vertex, class Position>
+void buildLods(std::vector<LodLevel> &levels, std::vector<Vertex> &vertices, std::vector<int> &indices, Position Vertex::*position,
+	size_t maxLevels = 8, float reduction = 0.5f, float maxError = std::numeric_limits<float>::max())
+{
+	static_assert(sizeof(Position) >= 3 * sizeof(float), "position needs three floats");
+
+	levels.clear();
+	if (indices.empty())
+		return;
+
+	std::vector<int> lodIndices;
+	const float *positions = reinterpret_cast<const float*>(&(vertices[0].*position));
+	buildLodChain(levels, lodIndices, &indices[0], indices.size(), positions, vertices.size(), sizeof(Vertex),
+		maxLevels, reduction, maxError);
+
+	indices.swap(lodIndices);
+	optimizeVertexFetch(vertices, indices);
+}
+
+} // end namespace swr
@@ -0,0 +1,331 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OutputMerger.h"
+#include "SimdConfig.h"
+
+#include <algorithm>
+
+namespace swr {
+
+namespace {
+
+// x / 255 rounded to nearest for x in [0, 255 * 255].
+int div255(int x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// Channel i of a 0xAARRGGBB color, in memory order B, G, R, A.
+int channel(uint32_t c, int i)
+{
+	return (c >> (8 * i)) & 0xff;
+}
+
+int blendFactor(BlendFactor f, uint32_t s, uint32_t d, uint32_t k, int i)
+{
+	switch (f)
+	{
+		case BlendFactor::Zero: return 0;
+		case BlendFactor::One: return 255;
+		case BlendFactor::SrcColor: return channel(s, i);
+		case BlendFactor::InvSrcColor: return 255 - channel(s, i);
+		case BlendFactor::SrcAlpha: return channel(s, 3);
+		case BlendFactor::InvSrcAlpha: return 255 - channel(s, 3);
+		case BlendFactor::DstColor: return channel(d, i);
+		case BlendFactor::InvDstColor: return 255 - channel(d, i);
+		case BlendFactor::DstAlpha: return channel(d, 3);
+		case BlendFactor::InvDstAlpha: return 255 - channel(d, 3);
+		case BlendFactor::ConstantColor: return channel(k, i);
+		case BlendFactor::InvConstantColor: return 255 - channel(k, i);
+		case BlendFactor::ConstantAlpha: return channel(k, 3);
+		case BlendFactor::InvConstantAlpha: return 255 - channel(k, 3);
+	}
+
+	return 0;
+}
+
+int blendChannel(BlendOp op, int s, int d, int sf, int df)
+{
+	switch (op)
+	{
+		case BlendOp::Add: return std::min(255, div255(s * sf) + div255(d * df));
+		case BlendOp::Subtract: return std::max(0, div255(s * sf) - div255(d * df));
+		case BlendOp::ReverseSubtract: return std::max(0, div255(d * df) - div255(s * sf));
+		case BlendOp::Min: return std::min(s, d);
+		case BlendOp::Max: return std::max(s, d);
+	}
+
+	return s;
+}
+
+uint32_t logicOp(LogicOp op, uint32_t s, uint32_t d)
+{
+	switch (op)
+	{
+		case LogicOp::Clear: return 0;
+		case LogicOp::Set: return ~0u;
+		case LogicOp::Copy: return s;
+		case LogicOp::CopyInverted: return ~s;
+		case LogicOp::Noop: return d;
+		case LogicOp::Invert: return ~d;
+		case LogicOp::And: return s & d;
+		case LogicOp::Nand: return ~(s & d);
+		case LogicOp::Or: return s | d;
+		case LogicOp::Nor: return ~(s | d);
+		case LogicOp::Xor: return s ^ d;
+		case LogicOp::Equiv: return ~(s ^ d);
+		case LogicOp::AndReverse: return s & ~d;
+		case LogicOp::AndInverted: return ~s & d;
+		case LogicOp::OrReverse: return s | ~d;
+		case LogicOp::OrInverted: return ~s | d;
+	}
+
+	return s;
+}
+
+// Bits of a 0xAARRGGBB color selected by a ColorWriteMask combination.
+uint32_t channelBits(int writeMask)
+{
+	uint32_t bits = 0;
+	if (writeMask & ColorWriteMask::Red) bits |= 0x00ff0000;
+	if (writeMask & ColorWriteMask::Green) bits |= 0x0000ff00;
+	if (writeMask & ColorWriteMask::Blue) bits |= 0x000000ff;
+	if (writeMask & ColorWriteMask::Alpha) bits |= 0xff000000;
+	return bits;
+}
+
+uint32_t rgb565ToRGBA8(uint16_t c)
+{
+	uint32_t r = (c >> 11) & 0x1f;
+	uint32_t g = (c >> 5) & 0x3f;
+	uint32_t b = c & 0x1f;
+	return 0xff000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+uint16_t rgba8ToRGB565(uint32_t c)
+{
+	return (uint16_t)(((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f));
+}
+
+#ifdef SWR_USE_SSE2
+
+// The functions below work on two pixels with one 16 bit lane per channel.
+
+__m128i div255(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+__m128i inverse(__m128i v)
+{
+	return _mm_sub_epi16(_mm_set1_epi16(255), v);
+}
+
+__m128i broadcastAlpha(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+__m128i blendFactor(BlendFactor f, __m128i s, __m128i d, __m128i k)
+{
+	switch (f)
+	{
+		case BlendFactor::Zero: return _mm_setzero_si128();
+		case BlendFactor::One: return _mm_set1_epi16(255);
+		case BlendFactor::SrcColor: return s;
+		case BlendFactor::InvSrcColor: return inverse(s);
+		case BlendFactor::SrcAlpha: return broadcastAlpha(s);
+		case BlendFactor::InvSrcAlpha: return inverse(broadcastAlpha(s));
+		case BlendFactor::DstColor: return d;
+		case BlendFactor::InvDstColor: return inverse(d);
+		case BlendFactor::DstAlpha: return broadcastAlpha(d);
+		case BlendFactor::InvDstAlpha: return inverse(broadcastAlpha(d));
+		case BlendFactor::ConstantColor: return k;
+		case BlendFactor::InvConstantColor: return inverse(k);
+		case BlendFactor::ConstantAlpha: return broadcastAlpha(k);
+		case BlendFactor::InvConstantAlpha: return inverse(broadcastAlpha(k));
+	}
+
+	return _mm_setzero_si128();
+}
+
+// Results may leave [0, 255], the final pack saturates them.
+__m128i blendChannels(BlendOp op, __m128i s, __m128i d, __m128i sf, __m128i df)
+{
+	switch (op)
+	{
+		case BlendOp::Add: return _mm_add_epi16(div255(_mm_mullo_epi16(s, sf)), div255(_mm_mullo_epi16(d, df)));
+		case BlendOp::Subtract: return _mm_sub_epi16(div255(_mm_mullo_epi16(s, sf)), div255(_mm_mullo_epi16(d, df)));
+		case BlendOp::ReverseSubtract: return _mm_sub_epi16(div255(_mm_mullo_epi16(d, df)), div255(_mm_mullo_epi16(s, sf)));
+		case BlendOp::Min: return _mm_min_epi16(s, d);
+		case BlendOp::Max: return _mm_max_epi16(s, d);
+	}
+
+	return s;
+}
+
+__m128i blendPixels(const BlendState &b, __m128i s, __m128i d, __m128i k)
+{
+	__m128i color = blendChannels(b.colorOp, s, d, blendFactor(b.srcColor, s, d, k), blendFactor(b.dstColor, s, d, k));
+
+	if (b.srcAlpha == b.srcColor && b.dstAlpha == b.dstColor && b.alphaOp == b.colorOp)
+		return color;
+
+	__m128i alpha = blendChannels(b.alphaOp, s, d, blendFactor(b.srcAlpha, s, d, k), blendFactor(b.dstAlpha, s, d, k));
+	__m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	return _mm_or_si128(_mm_andnot_si128(alphaLanes, color), _mm_and_si128(alphaLanes, alpha));
+}
+
+// Works on four pixels with 32 bits each.
+__m128i logicOp(LogicOp op, __m128i s, __m128i d)
+{
+	__m128i ones = _mm_set1_epi32(-1);
+
+	switch (op)
+	{
+		case LogicOp::Clear: return _mm_setzero_si128();
+		case LogicOp::Set: return ones;
+		case LogicOp::Copy: return s;
+		case LogicOp::CopyInverted: return _mm_xor_si128(s, ones);
+		case LogicOp::Noop: return d;
+		case LogicOp::Invert: return _mm_xor_si128(d, ones);
+		case LogicOp::And: return _mm_and_si128(s, d);
+		case LogicOp::Nand: return _mm_xor_si128(_mm_and_si128(s, d), ones);
+		case LogicOp::Or: return _mm_or_si128(s, d);
+		case LogicOp::Nor: return _mm_xor_si128(_mm_or_si128(s, d), ones);
+		case LogicOp::Xor: return _mm_xor_si128(s, d);
+		case LogicOp::Equiv: return _mm_xor_si128(_mm_xor_si128(s, d), ones);
+		case LogicOp::AndReverse: return _mm_andnot_si128(d, s);
+		case LogicOp::AndInverted: return _mm_andnot_si128(s, d);
+		case LogicOp::OrReverse: return _mm_or_si128(s, _mm_xor_si128(d, ones));
+		case LogicOp::OrInverted: return _mm_or_si128(_mm_xor_si128(s, ones), d);
+	}
+
+	return s;
+}
+
+#endif
+
+} // end anonymous namespace
+
+uint32_t OutputMerger::merge(uint32_t src, uint32_t dst) const
+{
+	uint32_t result = src;
+
+	if (m_blend.logicOpEnable)
+	{
+		result = logicOp(m_blend.logicOp, src, dst);
+	}
+	else if (m_blend.blendEnable)
+	{
+		result = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			bool alpha = i == 3;
+			int sf = blendFactor(alpha ? m_blend.srcAlpha : m_blend.srcColor, src, dst, m_blend.constant, i);
+			int df = blendFactor(alpha ? m_blend.dstAlpha : m_blend.dstColor, src, dst, m_blend.constant, i);
+			int c = blendChannel(alpha ? m_blend.alphaOp : m_blend.colorOp, channel(src, i), channel(dst, i), sf, df);
+			result |= (uint32_t)c << (8 * i);
+		}
+	}
+
+	uint32_t bits = channelBits(m_blend.writeMask);
+	return (result & bits) | (dst & ~bits);
+}
+
+void OutputMerger::mergePixel(uint32_t src, void *dst, RenderTargetFormat format) const
+{
+	switch (format)
+	{
+		case RenderTargetFormat::RGBA8:
+			*(uint32_t*)dst = merge(src, *(uint32_t*)dst);
+			break;
+		case RenderTargetFormat::RGB565:
+			*(uint16_t*)dst = rgba8ToRGB565(merge(src, rgb565ToRGBA8(*(uint16_t*)dst)));
+			break;
+		default:
+			*(uint32_t*)dst = src;
+			break;
+	}
+}
+
+void OutputMerger::mergeRow(const uint32_t *src, void *dst, unsigned mask, RenderTargetFormat format) const
+{
+#ifdef SWR_USE_SSE2
+	static_assert(RowSize % 4 == 0, "rows are merged in groups of four pixels");
+
+	if (format == RenderTargetFormat::RGBA8)
+	{
+		uint32_t *d32 = (uint32_t*)dst;
+
+		__m128i zero = _mm_setzero_si128();
+		__m128i k = _mm_unpacklo_epi8(_mm_set1_epi32((int)m_blend.constant), zero);
+		__m128i bits = _mm_set1_epi32((int)channelBits(m_blend.writeMask));
+		__m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+
+		for (int i = 0; i < RowSize; i += 4)
+		{
+			unsigned laneMask = (mask >> i) & 0xf;
+			if (!laneMask)
+				continue;
+
+			__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i d = _mm_loadu_si128((const __m128i*)(d32 + i));
+			__m128i r = s;
+
+			if (m_blend.logicOpEnable)
+			{
+				r = logicOp(m_blend.logicOp, s, d);
+			}
+			else if (m_blend.blendEnable)
+			{
+				__m128i lo = blendPixels(m_blend, _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), k);
+				__m128i hi = blendPixels(m_blend, _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), k);
+				r = _mm_packus_epi16(lo, hi);
+			}
+
+			// Keep the destination for uncovered pixels and masked channels.
+			__m128i covered = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)laneMask), laneBits), laneBits);
+			__m128i select = _mm_and_si128(covered, bits);
+			r = _mm_or_si128(_mm_and_si128(select, r), _mm_andnot_si128(select, d));
+
+			_mm_storeu_si128((__m128i*)(d32 + i), r);
+		}
+
+		return;
+	}
+#endif
+
+	int bytesPerPixel = RenderTarget::bytesPerPixel(format);
+
+	for (int i = 0; i < RowSize; ++i)
+		if (mask & (1u << i))
+			mergePixel(src[i], (unsigned char*)dst + i * bytesPerPixel, format);
+}
+
+} // end namespace swr
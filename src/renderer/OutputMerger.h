@@ -0,0 +1,240 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstdint>
+
+#include "RenderTarget.h"
+
+namespace swr {
+
+/// Blend factors of the output merger.
+/** Colors are treated as four channels in the range [0, 1]. The alpha
+  channel uses the alpha component of color factors. */
+enum class BlendFactor {
+	Zero,
+	One,
+	SrcColor,
+	InvSrcColor,
+	SrcAlpha,
+	InvSrcAlpha,
+	DstColor,
+	InvDstColor,
+	DstAlpha,
+	InvDstAlpha,
+	ConstantColor,
+	InvConstantColor,
+	ConstantAlpha,
+	InvConstantAlpha
+};
+
+/// Blend equations of the output merger.
+/** Min and Max ignore the blend factors. */
+enum class BlendOp {
+	Add,             ///< src * srcFactor + dst * dstFactor
+	Subtract,        ///< src * srcFactor - dst * dstFactor
+	ReverseSubtract, ///< dst * dstFactor - src * srcFactor
+	Min,             ///< min(src, dst)
+	Max              ///< max(src, dst)
+};
+
+/// Bitwise logic operations between the shader color (s) and the target (d).
+enum class LogicOp {
+	Clear,        ///< 0
+	Set,          ///< ~0
+	Copy,         ///< s
+	CopyInverted, ///< ~s
+	Noop,         ///< d
+	Invert,       ///< ~d
+	And,          ///< s & d
+	Nand,         ///< ~(s & d)
+	Or,           ///< s | d
+	Nor,          ///< ~(s | d)
+	Xor,          ///< s ^ d
+	Equiv,        ///< ~(s ^ d)
+	AndReverse,   ///< s & ~d
+	AndInverted,  ///< ~s & d
+	OrReverse,    ///< s | ~d
+	OrInverted    ///< ~s | d
+};
+
+/// Bits of BlendState::writeMask.
+struct ColorWriteMask {
+	enum Enum {
+		Red = 0x1,
+		Green = 0x2,
+		Blue = 0x4,
+		Alpha = 0x8,
+		All = 0xf
+	};
+};
+
+/// Depth comparison functions.
+/** The incoming z value is compared against the stored depth. */
+enum class DepthFunc {
+	Never,
+	Less,
+	Equal,
+	LessEqual,
+	Greater,
+	NotEqual,
+	GreaterEqual,
+	Always
+};
+
+/// Blend state of the output merger.
+struct BlendState {
+	/// Enables blending with the color equations below.
+	bool blendEnable;
+
+	BlendFactor srcColor; ///< Source factor of the color channels.
+	BlendFactor dstColor; ///< Destination factor of the color channels.
+	BlendOp colorOp;      ///< Equation of the color channels.
+
+	BlendFactor srcAlpha; ///< Source factor of the alpha channel.
+	BlendFactor dstAlpha; ///< Destination factor of the alpha channel.
+	BlendOp alphaOp;      ///< Equation of the alpha channel.
+
+	/// Blend constant as 0xAARRGGBB.
+	uint32_t constant;
+
+	/// Enables the logic operation. Blending is skipped while it is enabled.
+	bool logicOpEnable;
+	LogicOp logicOp;
+
+	/// Channels written to the color target, a combination of ColorWriteMask bits.
+	int writeMask;
+
+	BlendState()
+		: blendEnable(false)
+		, srcColor(BlendFactor::One)
+		, dstColor(BlendFactor::Zero)
+		, colorOp(BlendOp::Add)
+		, srcAlpha(BlendFactor::One)
+		, dstAlpha(BlendFactor::Zero)
+		, alphaOp(BlendOp::Add)
+		, constant(0)
+		, logicOpEnable(false)
+		, logicOp(LogicOp::Copy)
+		, writeMask(ColorWriteMask::All)
+	{
+	}
+};
+
+/// Depth state of the output merger.
+/** The depth test reads PixelData::z, so shaders using it must set
+  InterpolateZ. */
+struct DepthState {
+	/// Enables the depth test. Depth is only written while it is enabled.
+	bool depthTest;
+
+	/// Writes z of pixels passing the test to the depth target.
+	bool depthWrite;
+
+	DepthFunc func;
+
+	DepthState()
+		: depthTest(false)
+		, depthWrite(true)
+		, func(DepthFunc::Less)
+	{
+	}
+};
+
+/// Output merger stage.
+/** Combines the colors returned by pixel shaders with ColorOutput set with
+  the color target. The depth test runs before the shader, blending or the
+  logic operation and the write mask after it. Rows of a tile are merged
+  as packets of TileSize pixels with SSE2 where available.
+
+  Blending and logic operations work on RGBA8 targets. RGB565 targets are
+  converted to RGBA8 with opaque alpha for the merge. R32F targets receive
+  the bits of the shader color unchanged. */
+class OutputMerger {
+public:
+	/// Number of pixels merged by mergeRow().
+	static const int RowSize = RenderTarget::TileSize;
+
+	void setBlendState(const BlendState &state) { m_blend = state; }
+	const BlendState &blendState() const { return m_blend; }
+
+	void setDepthState(const DepthState &state) { m_depth = state; }
+	const DepthState &depthState() const { return m_depth; }
+
+	/// Whether the depth test runs against the given depth target.
+	bool depthTestEnabled(const RenderTarget *depthTarget) const
+	{
+		return depthTarget && m_depth.depthTest;
+	}
+
+	/// Compare z against the stored depth and update it if the test passes.
+	bool testDepth(float z, float *depth) const
+	{
+		bool pass;
+		switch (m_depth.func)
+		{
+			case DepthFunc::Never: pass = false; break;
+			case DepthFunc::Less: pass = z < *depth; break;
+			case DepthFunc::Equal: pass = z == *depth; break;
+			case DepthFunc::LessEqual: pass = z <= *depth; break;
+			case DepthFunc::Greater: pass = z > *depth; break;
+			case DepthFunc::NotEqual: pass = z != *depth; break;
+			case DepthFunc::GreaterEqual: pass = z >= *depth; break;
+			default: pass = true; break;
+		}
+
+		if (pass && m_depth.depthWrite)
+			*depth = z;
+
+		return pass;
+	}
+
+	/// Merge a color with a RGBA8 destination value.
+	uint32_t merge(uint32_t src, uint32_t dst) const;
+
+	/// Merge a color into a single pixel of a target with the given format.
+	void mergePixel(uint32_t src, void *dst, RenderTargetFormat format) const;
+
+	/// Merge RowSize colors into a row of pixels.
+	/** Pixel i is only written if bit i of mask is set. dst points to the
+	  first pixel of the row. */
+	void mergeRow(const uint32_t *src, void *dst, unsigned mask, RenderTargetFormat format) const;
+
+private:
+	BlendState m_blend;
+	DepthState m_depth;
+};
+
+/// The render targets and output merger state bound to a Rasterizer.
+/** Either target pointer may be nullptr. */
+struct FrameBuffer {
+	RenderTarget *color;
+	RenderTarget *depth;
+	OutputMerger merger;
+};
+
+} // end namespace swr
@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PipelineStatistics.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace swr {
+
+namespace {
+
+// Counters of every thread which ever counted. They are kept after the
+// thread ends, so the work of finished pool threads is not lost.
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<PipelineStatistics>> threads;
+};
+
+Registry &registry()
+{
+	static Registry instance;
+	return instance;
+}
+
+} // end anonymous namespace
+
+void PipelineStatistics::reset()
+{
+	verticesFetched = verticesShaded = vertexCacheHits = 0;
+	primitivesClipped = primitivesCulled = clipperOutput = trianglesSetUp = 0;
+	emptyBlocks = partialBlocks = fullBlocks = 0;
+	pixelsTested = pixelsShaded = pixelsWritten = 0;
+	vertexNs = clipNs = setupNs = rasterNs = 0;
+}
+
+void PipelineStatistics::add(const PipelineStatistics &other)
+{
+	verticesFetched += other.verticesFetched;
+	verticesShaded += other.verticesShaded;
+	vertexCacheHits += other.vertexCacheHits;
+	primitivesClipped += other.primitivesClipped;
+	primitivesCulled += other.primitivesCulled;
+	clipperOutput += other.clipperOutput;
+	trianglesSetUp += other.trianglesSetUp;
+	emptyBlocks += other.emptyBlocks;
+	partialBlocks += other.partialBlocks;
+	fullBlocks += other.fullBlocks;
+	pixelsTested += other.pixelsTested;
+	pixelsShaded += other.pixelsShaded;
+	pixelsWritten += other.pixelsWritten;
+	vertexNs += other.vertexNs;
+	clipNs += other.clipNs;
+	setupNs += other.setupNs;
+	rasterNs += other.rasterNs;
+}
+
+PipelineStatistics collectStatistics()
+{
+	Registry &r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	PipelineStatistics sum;
+	for (const auto &statistics : r.threads)
+		sum.add(*statistics);
+	return sum;
+}
+
+void resetStatistics()
+{
+	Registry &r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	for (const auto &statistics : r.threads)
+		statistics->reset();
+}
+
+PipelineStatistics *registerThreadStatistics()
+{
+	Registry &r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	r.threads.push_back(std::unique_ptr<PipelineStatistics>(new PipelineStatistics()));
+	return r.threads.back().get();
+}
+
+} // end namespace swr
@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <cstdint>
+
+#ifdef SWR_ENABLE_STATISTICS
+#include <chrono>
+#endif
+
+namespace swr {
+
+/// Counters of the pipeline stages.
+/** Only counted if the renderer is built with SWR_ENABLE_STATISTICS, the
+  SWR_STATISTICS option of the CMake project. Otherwise the counting
+  macros expand to nothing. Each thread counts into its own copy, read
+  the sum with collectStatistics() after a draw or frame. */
+struct PipelineStatistics {
+	uint64_t verticesFetched;   ///< Indices looked up in the vertex cache.
+	uint64_t verticesShaded;    ///< Vertex shader invocations.
+	uint64_t vertexCacheHits;   ///< Indices found in the vertex cache.
+
+	uint64_t primitivesClipped; ///< Primitives crossing a frustum plane.
+	uint64_t primitivesCulled;  ///< Primitives clipped away entirely, back facing or outside the scissor rect.
+	uint64_t clipperOutput;     ///< Primitives produced by clipping the primitives crossing a plane.
+	uint64_t trianglesSetUp;    ///< Triangles passed on to rasterization.
+
+	uint64_t emptyBlocks;       ///< Blocks of RasterMode::Block outside the triangle.
+	uint64_t partialBlocks;     ///< Blocks tested pixel by pixel.
+	uint64_t fullBlocks;        ///< Blocks covered by the triangle.
+
+	uint64_t pixelsTested;      ///< Covered pixels, the depth test runs on these.
+	uint64_t pixelsShaded;      ///< Calls of drawPixel() or shadePixel().
+	uint64_t pixelsWritten;     ///< Pixels merged into a color target.
+
+	/// Nanoseconds spent in each stage on the thread calling the draw.
+	/** Parallel work is included in the stage that started it. */
+	uint64_t vertexNs;
+	uint64_t clipNs;
+	uint64_t setupNs;
+	uint64_t rasterNs;
+
+	PipelineStatistics()
+	{
+		reset();
+	}
+
+	/// Set all counters to zero.
+	void reset();
+
+	/// Add the counters of another set.
+	void add(const PipelineStatistics &other);
+};
+
+/// Whether the renderer was built with SWR_ENABLE_STATISTICS.
+#ifdef SWR_ENABLE_STATISTICS
+const bool StatisticsEnabled = true;
+#else
+const bool StatisticsEnabled = false;
+#endif
+
+/// Sum of the counters of all threads since the last resetStatistics().
+/** Must not be called while any thread renders. */
+PipelineStatistics collectStatistics();
+
+/// Set the counters of all threads to zero.
+/** Must not be called while any thread renders. */
+void resetStatistics();
+
+/// Register the counters of a new thread.
+PipelineStatistics *registerThreadStatistics();
+
+/// Counters of the calling thread.
+inline PipelineStatistics &threadStatistics()
+{
+	static thread_local PipelineStatistics *statistics = registerThreadStatistics();
+	return *statistics;
+}
+
+#ifdef SWR_ENABLE_STATISTICS
+
+/// Adds the time from construction to destruction to a counter.
+class StatisticsTimer {
+public:
+	explicit StatisticsTimer(uint64_t PipelineStatistics::*counter)
+		: m_counter(counter), m_start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~StatisticsTimer()
+	{
+		auto elapsed = std::chrono::steady_clock::now() - m_start;
+		threadStatistics().*m_counter += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+
+private:
+	uint64_t PipelineStatistics::*m_counter;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/// Add value to a counter of the calling thread.
+#define SWR_STATISTICS_ADD(counter, value) (::swr::threadStatistics().counter += (value))
+
+/// Run statement and add its duration to a counter of the calling thread.
+#define SWR_STATISTICS_TIME(counter, statement) \
+	do { ::swr::StatisticsTimer swrStatisticsTimer(&::swr::PipelineStatistics::counter); statement; } while (0)
+
+/// Add the time until the end of the enclosing scope to a counter of the calling thread.
+#define SWR_STATISTICS_SCOPE(counter) \
+	::swr::StatisticsTimer swrStatisticsScope(&::swr::PipelineStatistics::counter)
+
+#else
+
+#define SWR_STATISTICS_ADD(counter, value) ((void)0)
+#define SWR_STATISTICS_TIME(counter, statement) do { statement; } while (0)
+#define SWR_STATISTICS_SCOPE(counter) ((void)0)
+
+#endif
+
+} // end namespace swr
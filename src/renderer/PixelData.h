@@ -28,6 +28,7 @@ SOFTWARE.
 
 #include "IRasterizer.h"
 #include "TriangleEquations.h"
+#include "OutputMerger.h"
 
 namespace swr {
 
@@ -55,7 +56,23 @@ struct PixelData {
     // Triangle equations needed for derivative computation
     const TriangleEquations* equations;
 
-    PixelData() : equations(nullptr) {}
+    /// Pointer to this pixel in the bound color target or nullptr.
+    void *color;
+
+    /// Pointer to this pixel in the bound depth target or nullptr.
+    void *depth;
+
+    // Segment shared with the neighbouring pixels, see PixelShaderBase::SegmentSize.
+    const void *segment;
+
+    PixelData() : equations(nullptr), color(nullptr), depth(nullptr), segment(nullptr) {}
+
+    // Point the target pointers at pixel (x, y) of the frame buffer.
+    void setTargets(const FrameBuffer &fb, int x, int y)
+    {
+        color = fb.color ? fb.color->pixel(x, y) : nullptr;
+        depth = fb.depth ? fb.depth->pixel(x, y) : nullptr;
+    }
 
     // Initialize pixel data for the given pixel coordinates.
     void init(const TriangleEquations &eqn, float x, float y, int aVarCount, int pVarCount, bool interpolateZ, bool interpolateW)
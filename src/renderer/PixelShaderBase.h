@@ -26,8 +26,12 @@ SOFTWARE.
 
 /** @file */
 
+#include <algorithm>
+#include <cstdint>
+
 #include "TriangleEquations.h"
 #include "PixelData.h"
+#include "PipelineStatistics.h"
 
 namespace swr {
 
@@ -36,7 +40,17 @@ namespace swr {
 
 /// Pixel shader base class.
 /** Derive your own pixel shaders from this class and redefine the static
-  variables to match your pixel shader requirements. */
+  variables to match your pixel shader requirements. Shader state such as
+  render targets and textures lives in the shader instance, which is bound
+  to a Rasterizer with Rasterizer::setPixelShader(). The same instance is
+  used from multiple threads, so drawPixel() must not modify it.
+
+  Shaders which set ColorOutput implement shadePixel() instead of
+  drawPixel(). The returned color goes through the depth test and the
+  OutputMerger of the rasterizer.
+
+  Shaders which set SegmentSize compute slowly changing values such as
+  texture footprints in beginSegment() and read them with segment(). */
 template <class Derived>
 class PixelShaderBase {
 public:
@@ -52,12 +66,40 @@ public:
 	/// Tells the rasterizer how many perspective vars to interpolate.
 	static const int PVarCount = 0;
 
+	/// Tells the rasterizer that shadePixel() returns a color for the output merger.
+	static const bool ColorOutput = false;
+
+	/// Tells the rasterizer how many pixels share one Segment, 0 for none.
+	/** The rasterizer calls beginSegment() for the first covered pixel of
+	  every SegmentSize pixels along a span or block row. The pixels up to
+	  the next call see the result through segment(). Single pixels of
+	  points, lines and small triangles get their own segment. */
+	static const int SegmentSize = 0;
+
+	/// Data shared by the pixels of a segment, redefine it in your shader.
+	struct Segment {};
+
 	template <bool TestEdges>
-	static void drawBlock(const TriangleEquations &eqn, int x, int y)
+	void drawBlock(const TriangleEquations &eqn, int x, int y, const FrameBuffer &fb) const
 	{
+		if (Derived::ColorOutput)
+		{
+			drawBlockMerged<TestEdges>(eqn, x, y, fb);
+			return;
+		}
+
 		float xf = x + 0.5f;
 		float yf = y + 0.5f;
 
+		// Blocks are aligned to the tile grid, so the block is a single tile.
+		// The pointers stay nullptr if no target is bound.
+		unsigned char *colorTile = nullptr;
+		unsigned char *depthTile = nullptr;
+		if (fb.color || fb.depth)
+			blockTargets(fb, x, y, colorTile, depthTile);
+		int colorBpp = fb.color ? fb.color->bytesPerPixel() : 0;
+		int depthBpp = fb.depth ? fb.depth->bytesPerPixel() : 0;
+
 		PixelData po;
 		po.init(eqn, xf, yf, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
 
@@ -73,13 +115,22 @@ public:
 			if (TestEdges)
 				ei = eo;
 
+			typename Derived::Segment segment;
+			int segmentEnd = x;
+
 			for (int xx = x; xx < x + BlockSize; xx++)
 			{
 				if (!TestEdges || ei.test(eqn))
 				{
+					int offset = (yy - y) * BlockSize + (xx - x);
 					pi.x = xx;
 					pi.y = yy;
-					Derived::drawPixel(pi);
+					pi.color = colorTile + offset * colorBpp;
+					pi.depth = depthTile + offset * depthBpp;
+					stepSegment(pi, segment, segmentEnd);
+					derived().drawPixel(pi);
+					SWR_STATISTICS_ADD(pixelsTested, 1);
+					SWR_STATISTICS_ADD(pixelsShaded, 1);
 				}
 
 				pi.stepX(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
@@ -93,8 +144,14 @@ public:
 		}
 	}
 
-	static void drawSpan(const TriangleEquations &eqn, int x, int y, int x2)
+	void drawSpan(const TriangleEquations &eqn, int x, int y, int x2, const FrameBuffer &fb) const
 	{
+		if (Derived::ColorOutput || fb.color || fb.depth)
+		{
+			drawSpanTargets(eqn, x, y, x2, fb);
+			return;
+		}
+
 		float xf = x + 0.5f;
 		float yf = y + 0.5f;
 
@@ -102,23 +159,317 @@ public:
 		p.y = y;
 		p.init(eqn, xf, yf, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
 
+		SWR_STATISTICS_ADD(pixelsTested, std::max(x2 - x, 0));
+		SWR_STATISTICS_ADD(pixelsShaded, std::max(x2 - x, 0));
+
+		typename Derived::Segment segment;
+		int segmentEnd = x;
+
 		while (x < x2)
 		{
 			p.x = x;
-			Derived::drawPixel(p);
+			stepSegment(p, segment, segmentEnd);
+			derived().drawPixel(p);
 			p.stepX(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
 			x++;
 		}
 	}
 
+	/// Draw a triangle covering only a few pixels.
+	/** Tests each pixel center in the inclusive rect directly and skips
+	  the incremental interpolation setup used for blocks and spans. */
+	void drawSmallTriangle(const TriangleEquations &eqn, int minX, int minY, int maxX, int maxY, const FrameBuffer &fb) const
+	{
+		float xf = minX + 0.5f;
+		float yf = minY + 0.5f;
+
+		EdgeData eo;
+		eo.init(eqn, xf, yf);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			EdgeData ei = eo;
+
+			for (int x = minX; x <= maxX; x++)
+			{
+				if (ei.test(eqn))
+				{
+					PixelData p;
+					p.init(eqn, x + 0.5f, y + 0.5f, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+					p.x = x;
+					p.y = y;
+					if (fb.color || fb.depth)
+						p.setTargets(fb, x, y);
+					drawSinglePixel(p, fb);
+				}
+
+				ei.stepX(eqn);
+			}
+
+			eo.stepY(eqn);
+		}
+	}
+
+	/// Draw a single pixel whose target pointers are set.
+	/** Used for points, lines and small triangles. */
+	void drawSinglePixel(const PixelData &p, const FrameBuffer &fb) const
+	{
+		if (Derived::SegmentSize > 0 && !p.segment)
+		{
+			typename Derived::Segment segment;
+			derived().beginSegment(p, segment);
+			PixelData ps = p;
+			ps.segment = &segment;
+			drawSinglePixel(ps, fb);
+			return;
+		}
+
+		SWR_STATISTICS_ADD(pixelsTested, 1);
+
+		if (!Derived::ColorOutput)
+		{
+			derived().drawPixel(p);
+			SWR_STATISTICS_ADD(pixelsShaded, 1);
+			return;
+		}
+
+		const OutputMerger &merger = fb.merger;
+		if (merger.depthTestEnabled(fb.depth) && !merger.testDepth(p.z, (float*)p.depth))
+			return;
+
+		uint32_t color = derived().shadePixel(p);
+		SWR_STATISTICS_ADD(pixelsShaded, 1);
+		if (p.color)
+		{
+			merger.mergePixel(color, p.color, fb.color->format());
+			SWR_STATISTICS_ADD(pixelsWritten, 1);
+		}
+	}
+
 	/// This is called per pixel. 
 	/** Implement this in your derived class to display single pixels. */
-	static void drawPixel(const PixelData &p)
+	void drawPixel(const PixelData &p) const
 	{
 
 	}
 
+	/// This is called per pixel if ColorOutput is set.
+	/** Implement this in your derived class to return the color of a pixel
+	  as 0xAARRGGBB. */
+	uint32_t shadePixel(const PixelData &p) const
+	{
+		return 0;
+	}
+
+	/// This is called for the first pixel of each segment if SegmentSize is set.
+	/** Implement this in your derived class to fill its Segment. */
+	template <class SegmentType>
+	void beginSegment(const PixelData &, SegmentType &) const {}
+
+	/// The segment of a pixel, valid in drawPixel() and shadePixel() if SegmentSize is set.
+	template <class Shader = Derived>
+	static const typename Shader::Segment &segment(const PixelData &p)
+	{
+		return *static_cast<const typename Shader::Segment*>(p.segment);
+	}
+
 protected:
+	const Derived &derived() const
+	{
+		return *static_cast<const Derived*>(this);
+	}
+
+	// Begin a new segment at pixel p.x if the current one has ended.
+	template <class SegmentType>
+	void stepSegment(PixelData &p, SegmentType &segment, int &segmentEnd) const
+	{
+		if (Derived::SegmentSize > 0 && p.x >= segmentEnd)
+		{
+			derived().beginSegment(p, segment);
+			p.segment = &segment;
+			segmentEnd = p.x + Derived::SegmentSize;
+		}
+	}
+
+	// Resolve the tiles of the bound targets covering the block at (x, y).
+	static void blockTargets(const FrameBuffer &fb, int x, int y, unsigned char *&colorTile, unsigned char *&depthTile)
+	{
+		colorTile = fb.color ? fb.color->tile(x / BlockSize, y / BlockSize) : nullptr;
+		depthTile = fb.depth ? fb.depth->tile(x / BlockSize, y / BlockSize) : nullptr;
+	}
+
+	// drawSpan() with render targets bound. Pixels of a span are contiguous
+	// within a tile row, so the target pointers are resolved once per tile.
+	void drawSpanTargets(const TriangleEquations &eqn, int x, int y, int x2, const FrameBuffer &fb) const
+	{
+		if (Derived::ColorOutput)
+		{
+			drawSpanMerged(eqn, x, y, x2, fb);
+			return;
+		}
+
+		float xf = x + 0.5f;
+		float yf = y + 0.5f;
+
+		int colorBpp = fb.color ? fb.color->bytesPerPixel() : 0;
+		int depthBpp = fb.depth ? fb.depth->bytesPerPixel() : 0;
+
+		PixelData p;
+		p.y = y;
+		p.init(eqn, xf, yf, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+
+		SWR_STATISTICS_ADD(pixelsTested, std::max(x2 - x, 0));
+		SWR_STATISTICS_ADD(pixelsShaded, std::max(x2 - x, 0));
+
+		typename Derived::Segment segment;
+		int segmentEnd = x;
+
+		while (x < x2)
+		{
+			int tileEnd = std::min(x2, (x / BlockSize + 1) * BlockSize);
+			p.setTargets(fb, x, y);
+
+			for (; x < tileEnd; x++)
+			{
+				p.x = x;
+				stepSegment(p, segment, segmentEnd);
+				derived().drawPixel(p);
+				p.stepX(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+				p.color = (unsigned char*)p.color + colorBpp;
+				p.depth = (unsigned char*)p.depth + depthBpp;
+			}
+		}
+	}
+
+	// drawBlock() for shaders with ColorOutput. The colors of each block row
+	// are collected and merged as one packet.
+	template <bool TestEdges>
+	void drawBlockMerged(const TriangleEquations &eqn, int x, int y, const FrameBuffer &fb) const
+	{
+		float xf = x + 0.5f;
+		float yf = y + 0.5f;
+
+		unsigned char *colorTile = nullptr;
+		unsigned char *depthTile = nullptr;
+		if (fb.color || fb.depth)
+			blockTargets(fb, x, y, colorTile, depthTile);
+		int colorBpp = fb.color ? fb.color->bytesPerPixel() : 0;
+		int depthBpp = fb.depth ? fb.depth->bytesPerPixel() : 0;
+
+		const OutputMerger &merger = fb.merger;
+		bool depthTest = merger.depthTestEnabled(fb.depth);
+
+		PixelData po;
+		po.init(eqn, xf, yf, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+
+		EdgeData eo;
+		if (TestEdges)
+			eo.init(eqn, xf, yf);
+
+		for (int yy = y; yy < y + BlockSize; yy++)
+		{
+			PixelData pi = copyPixelData(po);
+
+			EdgeData ei;
+			if (TestEdges)
+				ei = eo;
+
+			int rowOffset = (yy - y) * BlockSize;
+			uint32_t colors[BlockSize] = {};
+			unsigned mask = 0;
+
+			typename Derived::Segment segment;
+			int segmentEnd = x;
+
+			for (int i = 0; i < BlockSize; i++)
+			{
+				if (!TestEdges || ei.test(eqn))
+				{
+					pi.x = x + i;
+					pi.y = yy;
+					pi.color = colorTile + (rowOffset + i) * colorBpp;
+					pi.depth = depthTile + (rowOffset + i) * depthBpp;
+					SWR_STATISTICS_ADD(pixelsTested, 1);
+
+					if (!depthTest || merger.testDepth(pi.z, (float*)pi.depth))
+					{
+						stepSegment(pi, segment, segmentEnd);
+						colors[i] = derived().shadePixel(pi);
+						mask |= 1u << i;
+						SWR_STATISTICS_ADD(pixelsShaded, 1);
+						SWR_STATISTICS_ADD(pixelsWritten, colorTile != nullptr);
+					}
+				}
+
+				pi.stepX(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+				if (TestEdges)
+					ei.stepX(eqn);
+			}
+
+			if (mask && colorTile)
+				merger.mergeRow(colors, colorTile + rowOffset * colorBpp, mask, fb.color->format());
+
+			po.stepY(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+			if (TestEdges)
+				eo.stepY(eqn);
+		}
+	}
+
+	// drawSpan() for shaders with ColorOutput. The part of the span inside
+	// each tile row is merged as one packet.
+	void drawSpanMerged(const TriangleEquations &eqn, int x, int y, int x2, const FrameBuffer &fb) const
+	{
+		float xf = x + 0.5f;
+		float yf = y + 0.5f;
+
+		int colorBpp = fb.color ? fb.color->bytesPerPixel() : 0;
+		int depthBpp = fb.depth ? fb.depth->bytesPerPixel() : 0;
+
+		const OutputMerger &merger = fb.merger;
+		bool depthTest = merger.depthTestEnabled(fb.depth);
+
+		PixelData p;
+		p.y = y;
+		p.init(eqn, xf, yf, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+
+		typename Derived::Segment segment;
+		int segmentEnd = x;
+
+		while (x < x2)
+		{
+			int tileX = x / BlockSize * BlockSize;
+			int tileEnd = std::min(x2, tileX + BlockSize);
+			p.setTargets(fb, x, y);
+
+			// Start of the tile row in the color target.
+			unsigned char *colorRow = p.color ? (unsigned char*)p.color - (x - tileX) * colorBpp : nullptr;
+			uint32_t colors[BlockSize] = {};
+			unsigned mask = 0;
+
+			for (; x < tileEnd; x++)
+			{
+				p.x = x;
+				SWR_STATISTICS_ADD(pixelsTested, 1);
+
+				if (!depthTest || merger.testDepth(p.z, (float*)p.depth))
+				{
+					stepSegment(p, segment, segmentEnd);
+					colors[x - tileX] = derived().shadePixel(p);
+					mask |= 1u << (x - tileX);
+					SWR_STATISTICS_ADD(pixelsShaded, 1);
+					SWR_STATISTICS_ADD(pixelsWritten, colorRow != nullptr);
+				}
+
+				p.stepX(eqn, Derived::AVarCount, Derived::PVarCount, Derived::InterpolateZ, Derived::InterpolateW);
+				p.color = (unsigned char*)p.color + colorBpp;
+				p.depth = (unsigned char*)p.depth + depthBpp;
+			}
+
+			if (mask && colorRow)
+				merger.mergeRow(colors, colorRow, mask, fb.color->format());
+		}
+	}
+
 	static PixelData copyPixelData(PixelData &po)
 	{
 		PixelData pi;
@@ -27,14 +27,19 @@ SOFTWARE.
 /** @file */ 
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "IRasterizer.h"
 #include "EdgeEquation.h"
 #include "ParameterEquation.h"
+#include "TriangleSetup.h"
 #include "TriangleEquations.h"
 #include "PixelData.h"
 #include "EdgeData.h"
 #include "PixelShaderBase.h"
+#include "PipelineStatistics.h"
+#include "ThreadPool.h"
 
 namespace swr {
 
@@ -51,24 +56,51 @@ enum class RasterMode {
 /// Rasterizer main class.
 class Rasterizer : public IRasterizer {
 private:
-	int m_minX;
-	int m_maxX;
-	int m_minY;
-	int m_maxY;
+	// Number of blocks and scanlines per parallel task.
+	static const int BlockGrainSize = 4;
+	static const int SpanGrainSize = 16;
+
+	std::shared_ptr<ThreadPool> m_ownedThreadPool;
+	ThreadPool *m_threadPool;
+
+	ScissorRect m_scissor;
 
 	RasterMode rasterMode;
 
-	void (Rasterizer::*m_triangleFunc)(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const;
+	const void *m_pixelShader;
+	FrameBuffer m_frameBuffer;
+
+	void (Rasterizer::*m_triangleFunc)(const TriangleSetup *setups, size_t count) const;
 	void (Rasterizer::*m_lineFunc)(const RasterizerVertex &v0, const RasterizerVertex &v1) const;
 	void (Rasterizer::*m_pointFunc)(const RasterizerVertex &v) const;
 
+	// Output of the triangle setup stage for the current batch.
+	mutable std::vector<TriangleSetup> m_setupBuffer;
+
 public:
 	/// Constructor.
-	Rasterizer()
+	/** Parallel stages run on the given thread pool. If threadPool is
+	  nullptr the process wide ThreadPool::defaultPool() is used. */
+	explicit Rasterizer(ThreadPool *threadPool = nullptr)
+		: m_threadPool(threadPool ? threadPool : ThreadPool::defaultPool())
 	{
-		setRasterMode(RasterMode::Span);
-		setScissorRect(0, 0, 0, 0);
-		setPixelShader<NullPixelShader>();
+		init();
+	}
+
+	/// Constructor.
+	/** Creates a thread pool owned by this rasterizer. Pass threadPool() to
+	  the VertexProcessor to share it. */
+	explicit Rasterizer(const ThreadPoolConfig &config)
+		: m_ownedThreadPool(std::make_shared<ThreadPool>(config))
+		, m_threadPool(m_ownedThreadPool.get())
+	{
+		init();
+	}
+
+	/// The thread pool used by this rasterizer.
+	ThreadPool *threadPool() const
+	{
+		return m_threadPool;
 	}
 
 	/// Set the raster mode. The default is RasterMode::Span.
@@ -80,21 +112,58 @@ public:
 	/// Set the scissor rectangle.
 	void setScissorRect(int x, int y, int width, int height)
 	{
-		m_minX = x;
-		m_minY = y;
-		m_maxX = x + width;
-		m_maxY = y + height;
+		m_scissor.minX = x;
+		m_scissor.minY = y;
+		m_scissor.maxX = x + width;
+		m_scissor.maxY = y + height;
 	}
 	
+	/// Set the render targets.
+	/** The raster loops pass pointers to the current pixel in these targets
+	  to the pixel shader in PixelData::color and PixelData::depth. Either
+	  target may be nullptr. The scissor rect must lie inside the targets. */
+	void setRenderTargets(RenderTarget *color, RenderTarget *depth = nullptr)
+	{
+		m_frameBuffer.color = color;
+		m_frameBuffer.depth = depth;
+	}
+
+	/// Set the blend state of the output merger.
+	/** Only used by pixel shaders with ColorOutput. */
+	void setBlendState(const BlendState &state)
+	{
+		m_frameBuffer.merger.setBlendState(state);
+	}
+
+	/// Set the depth state of the output merger.
+	/** Only used by pixel shaders with ColorOutput. */
+	void setDepthState(const DepthState &state)
+	{
+		m_frameBuffer.merger.setDepthState(state);
+	}
+
 	/// Set the pixel shader.
+	/** The shader instance is not copied and must stay alive while it is
+	  bound. Each rasterizer can use its own instance, which allows several
+	  rasterizers to render concurrently with different shader state. */
 	template <class PixelShader>
-	void setPixelShader()
+	void setPixelShader(const PixelShader *shader)
 	{
-		m_triangleFunc = &Rasterizer::drawTriangleModeTemplate<PixelShader>;
+		m_pixelShader = shader;
+		m_triangleFunc = &Rasterizer::drawTriangleSetupListTemplate<PixelShader>;
 		m_lineFunc = &Rasterizer::drawLineTemplate<PixelShader>;
 		m_pointFunc = &Rasterizer::drawPointTemplate<PixelShader>;	
 	}
 
+	/// Set a pixel shader without state.
+	/** Binds a default constructed instance shared by all rasterizers. */
+	template <class PixelShader>
+	void setPixelShader()
+	{
+		static PixelShader shader;
+		setPixelShader(&shader);
+	}
+
 	/// Draw a single point.
 	void drawPoint(const RasterizerVertex &v) const
 	{
@@ -108,13 +177,17 @@ public:
 	}
 	
 	/// Draw a single triangle.
+	/** Triangles with a negative screen space area are culled. */
 	void drawTriangle(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
 	{
-		(this->*m_triangleFunc)(v0, v1, v2);
+		TriangleSetup setup;
+		if (setup.init(v0, v1, v2, CullMode::CCW, m_scissor))
+			(this->*m_triangleFunc)(&setup, 1);
 	}
 
 	void drawPointList(const RasterizerVertex *vertices, const int *indices, size_t indexCount) const
 	{
+		SWR_STATISTICS_SCOPE(rasterNs);
 		for (size_t i = 0; i < indexCount; ++i) {
 			if (indices[i] == -1)
 				continue;
@@ -124,6 +197,7 @@ public:
 
 	void drawLineList(const RasterizerVertex *vertices, const int *indices, size_t indexCount) const
 	{
+		SWR_STATISTICS_SCOPE(rasterNs);
 		for (size_t i = 0; i + 2 <= indexCount; i += 2) {
 			if (indices[i] == -1)
 				continue;
@@ -131,19 +205,52 @@ public:
 		}
 	}
 
-	void drawTriangleList(const RasterizerVertex *vertices, const int *indices, size_t indexCount) const
+	void drawTriangleList(const RasterizerVertex *vertices, const int *indices, size_t indexCount, CullMode cullMode) const
 	{
-		for (size_t i = 0; i + 3 <= indexCount; i += 3) {
-			if (indices[i] == -1)
-				continue;
-			drawTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
-		}
+		SWR_STATISTICS_TIME(setupNs, setupTriangles(vertices, indices, indexCount, cullMode));
+		if (!m_setupBuffer.empty())
+			SWR_STATISTICS_TIME(rasterNs, (this->*m_triangleFunc)(m_setupBuffer.data(), m_setupBuffer.size()));
 	}
 
 private:
+	void init()
+	{
+		setRasterMode(RasterMode::Span);
+		setScissorRect(0, 0, 0, 0);
+		setRenderTargets(nullptr, nullptr);
+		setPixelShader<NullPixelShader>();
+	}
+
+	template <class PixelShader>
+	const PixelShader &pixelShader() const
+	{
+		return *static_cast<const PixelShader*>(m_pixelShader);
+	}
+
 	bool scissorTest(float x, float y) const
 	{
-		return (x >= m_minX && x < m_maxX && y >= m_minY && y < m_maxY);
+		return (x >= m_scissor.minX && x < m_scissor.maxX && y >= m_scissor.minY && y < m_scissor.maxY);
+	}
+
+	// Triangle setup stage. Fills the setup buffer with the triangles
+	// which survive culling and scissor rejection.
+	void setupTriangles(const RasterizerVertex *vertices, const int *indices, size_t indexCount, CullMode cullMode) const
+	{
+		m_setupBuffer.clear();
+		m_setupBuffer.reserve(indexCount / 3);
+
+		TriangleSetup setup;
+		size_t triangleCount = 0;
+		for (size_t i = 0; i + 3 <= indexCount; i += 3) {
+			if (indices[i] == -1)
+				continue;
+			triangleCount++;
+			if (setup.init(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], cullMode, m_scissor))
+				m_setupBuffer.push_back(setup);
+		}
+
+		SWR_STATISTICS_ADD(primitivesCulled, triangleCount - m_setupBuffer.size());
+		SWR_STATISTICS_ADD(trianglesSetUp, m_setupBuffer.size());
 	}
 
 	template <class PixelShader>
@@ -154,7 +261,8 @@ private:
 			return;
 
 		PixelData p = pixelDataFromVertex<PixelShader>(v);
-		PixelShader::drawPixel(p);
+		p.setTargets(m_frameBuffer, p.x, p.y);
+		pixelShader<PixelShader>().drawSinglePixel(p, m_frameBuffer);
 	}
 
 	template<class PixelShader>
@@ -187,7 +295,10 @@ private:
 			PixelData p = pixelDataFromVertex<PixelShader>(v);
 
 			if (scissorTest(v.x, v.y))
-				PixelShader::drawPixel(p);
+			{
+				p.setTargets(m_frameBuffer, p.x, p.y);
+				pixelShader<PixelShader>().drawSinglePixel(p, m_frameBuffer);
+			}
 			
 			stepVertex<PixelShader>(v, step);
 		}
@@ -222,102 +333,94 @@ private:
 	}
 
 	template <class PixelShader>
-	void drawTriangleBlockTemplate(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawTriangleBlockTemplate(const TriangleSetup &setup) const
 	{
 		// Compute triangle equations.
-		TriangleEquations eqn(v0, v1, v2, PixelShader::AVarCount, PixelShader::PVarCount);
-
-		// Check if triangle is backfacing.
-		if (eqn.area2 <= 0)
-			return;
+		TriangleEquations eqn(setup, PixelShader::AVarCount, PixelShader::PVarCount);
 
-		// Compute triangle bounding box.
-		int minX = (int)std::min(std::min(v0.x, v1.x), v2.x);
-		int maxX = (int)std::max(std::max(v0.x, v1.x), v2.x);
-		int minY = (int)std::min(std::min(v0.y, v1.y), v2.y);
-		int maxY = (int)std::max(std::max(v0.y, v1.y), v2.y);
-
-		// Clip to scissor rect.
-		minX = std::max(minX, m_minX);
-		maxX = std::min(maxX, m_maxX);
-		minY = std::max(minY, m_minY);
-		maxY = std::min(maxY, m_maxY);
-
-		// Round to block grid.
-		minX = minX & ~(BlockSize - 1);
-		maxX = maxX & ~(BlockSize - 1);
-		minY = minY & ~(BlockSize - 1);
-		maxY = maxY & ~(BlockSize - 1);
-
-		float s = BlockSize - 1;
+		// Round bounding box to block grid.
+		int minX = setup.minX & ~(BlockSize - 1);
+		int maxX = setup.maxX & ~(BlockSize - 1);
+		int minY = setup.minY & ~(BlockSize - 1);
+		int maxY = setup.maxY & ~(BlockSize - 1);
 
 		int stepsX = (maxX - minX) / BlockSize + 1;
 		int stepsY = (maxY - minY) / BlockSize + 1;
 
-		#pragma omp parallel for
-		for (int i = 0; i < stepsX * stepsY; ++i)
-		{
-			int sx = i % stepsX;
-			int sy = i / stepsX;
+		m_threadPool->parallelFor(stepsX * stepsY, BlockGrainSize, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i)
+			{
+				int sx = i % stepsX;
+				int sy = i / stepsX;
+				drawBlockTemplate<PixelShader>(eqn, minX + sx * BlockSize, minY + sy * BlockSize);
+			}
+		});
+	}
+
+	template <class PixelShader>
+	void drawBlockTemplate(const TriangleEquations &eqn, int x, int y) const
+	{
+		float s = BlockSize - 1;
 
-			// Add 0.5 to sample at pixel centers.
-			int x = minX + sx * BlockSize;
-			int y = minY + sy * BlockSize;
+		// Add 0.5 to sample at pixel centers.
+		float xf = x + 0.5f;
+		float yf = y + 0.5f;
 
-			float xf = x + 0.5f;
-			float yf = y + 0.5f;
+		// Test if block is inside or outside triangle or touches it.
+		EdgeData e00; e00.init(eqn, xf, yf);
+		EdgeData e01 = e00; e01.stepY(eqn, s);
+		EdgeData e10 = e00; e10.stepX(eqn, s);
+		EdgeData e11 = e01; e11.stepX(eqn, s);
 
-			// Test if block is inside or outside triangle or touches it.
-			EdgeData e00; e00.init(eqn, xf, yf);
-			EdgeData e01 = e00; e01.stepY(eqn, s);
-			EdgeData e10 = e00; e10.stepX(eqn, s);
-			EdgeData e11 = e01; e11.stepX(eqn, s);
+		bool e00_0 = eqn.e0.test(e00.ev0), e00_1 = eqn.e1.test(e00.ev1), e00_2 = eqn.e2.test(e00.ev2), e00_all = e00_0 && e00_1 && e00_2;
+		bool e01_0 = eqn.e0.test(e01.ev0), e01_1 = eqn.e1.test(e01.ev1), e01_2 = eqn.e2.test(e01.ev2), e01_all = e01_0 && e01_1 && e01_2;
+		bool e10_0 = eqn.e0.test(e10.ev0), e10_1 = eqn.e1.test(e10.ev1), e10_2 = eqn.e2.test(e10.ev2), e10_all = e10_0 && e10_1 && e10_2;
+		bool e11_0 = eqn.e0.test(e11.ev0), e11_1 = eqn.e1.test(e11.ev1), e11_2 = eqn.e2.test(e11.ev2), e11_all = e11_0 && e11_1 && e11_2;
 
-			bool e00_0 = eqn.e0.test(e00.ev0), e00_1 = eqn.e1.test(e00.ev1), e00_2 = eqn.e2.test(e00.ev2), e00_all = e00_0 && e00_1 && e00_2;
-			bool e01_0 = eqn.e0.test(e01.ev0), e01_1 = eqn.e1.test(e01.ev1), e01_2 = eqn.e2.test(e01.ev2), e01_all = e01_0 && e01_1 && e01_2;
-			bool e10_0 = eqn.e0.test(e10.ev0), e10_1 = eqn.e1.test(e10.ev1), e10_2 = eqn.e2.test(e10.ev2), e10_all = e10_0 && e10_1 && e10_2;
-			bool e11_0 = eqn.e0.test(e11.ev0), e11_1 = eqn.e1.test(e11.ev1), e11_2 = eqn.e2.test(e11.ev2), e11_all = e11_0 && e11_1 && e11_2;
+		int result = e00_all + e01_all + e10_all + e11_all;
 
-			int result = e00_all + e01_all + e10_all + e11_all;
+		// Potentially all out.
+		if (result == 0)
+		{
+			// Test for special case.
+			bool e00Same = e00_0 == e00_1 == e00_2;
+			bool e01Same = e01_0 == e01_1 == e01_2;
+			bool e10Same = e10_0 == e10_1 == e10_2;
+			bool e11Same = e11_0 == e11_1 == e11_2;
 
-			// Potentially all out.
-			if (result == 0)
+			if (!e00Same || !e01Same || !e10Same || !e11Same)
 			{
-				// Test for special case.
-				bool e00Same = e00_0 == e00_1 == e00_2;
-				bool e01Same = e01_0 == e01_1 == e01_2;
-				bool e10Same = e10_0 == e10_1 == e10_2;
-				bool e11Same = e11_0 == e11_1 == e11_2;
-
-				if (!e00Same || !e01Same || !e10Same || !e11Same)
-					PixelShader::template drawBlock<true>(eqn, x, y);
-			}
-			else if (result == 4)
-			{
-				// Fully Covered.
-				PixelShader::template drawBlock<false>(eqn, x, y);
+				SWR_STATISTICS_ADD(partialBlocks, 1);
+				pixelShader<PixelShader>().template drawBlock<true>(eqn, x, y, m_frameBuffer);
 			}
 			else
 			{
-				// Partially Covered.
-				PixelShader::template drawBlock<true>(eqn, x, y);
+				SWR_STATISTICS_ADD(emptyBlocks, 1);
 			}
 		}
+		else if (result == 4)
+		{
+			// Fully Covered.
+			SWR_STATISTICS_ADD(fullBlocks, 1);
+			pixelShader<PixelShader>().template drawBlock<false>(eqn, x, y, m_frameBuffer);
+		}
+		else
+		{
+			// Partially Covered.
+			SWR_STATISTICS_ADD(partialBlocks, 1);
+			pixelShader<PixelShader>().template drawBlock<true>(eqn, x, y, m_frameBuffer);
+		}
 	}
 
 	template <class PixelShader>
-	void drawTriangleSpanTemplate(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawTriangleSpanTemplate(const TriangleSetup &setup) const
 	{
 		// Compute triangle equations.
-		TriangleEquations eqn(v0, v1, v2, PixelShader::AVarCount, PixelShader::PVarCount);
-
-		// Check if triangle is backfacing.
-		if (eqn.area2 <= 0)
-			return;
+		TriangleEquations eqn(setup, PixelShader::AVarCount, PixelShader::PVarCount);
 
-		const RasterizerVertex *t = &v0;
-		const RasterizerVertex *m = &v1;
-		const RasterizerVertex *b = &v2;
+		const RasterizerVertex *t = setup.v0;
+		const RasterizerVertex *m = setup.v1;
+		const RasterizerVertex *b = setup.v2;
 
 		// Sort vertices from top to bottom.
 		if (t->y > m->y) std::swap(t, m);
@@ -331,13 +434,13 @@ private:
 		{
 			const RasterizerVertex *l = m, *r = t;
 			if (l->x > r->x) std::swap(l, r);
-			drawTopFlatTriangle<PixelShader>(eqn, *l, *r, *b);
+			drawTopFlatTriangle<PixelShader>(setup, eqn, *l, *r, *b);
 		}
 		else if (m->y == b->y)
 		{
 			const RasterizerVertex *l = m, *r = b;
 			if (l->x > r->x) std::swap(l, r);
-			drawBottomFlatTriangle<PixelShader>(eqn, *t, *l, *r);
+			drawBottomFlatTriangle<PixelShader>(setup, eqn, *t, *l, *r);
 		} 
 		else
 		{
@@ -352,95 +455,122 @@ private:
 			const RasterizerVertex *l = m, *r = &v4;
 			if (l->x > r->x) std::swap(l, r);
 
-			drawBottomFlatTriangle<PixelShader>(eqn, *t, *l, *r);
-			drawTopFlatTriangle<PixelShader>(eqn, *l, *r, *b);
+			drawBottomFlatTriangle<PixelShader>(setup, eqn, *t, *l, *r);
+			drawTopFlatTriangle<PixelShader>(setup, eqn, *l, *r, *b);
 		}
 	}
 
 	template <class PixelShader>
-	void drawBottomFlatTriangle(const TriangleEquations &eqn, const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawBottomFlatTriangle(const TriangleSetup &setup, const TriangleEquations &eqn, const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
 	{
 		float invslope1 = (v1.x - v0.x) / (v1.y - v0.y);
 		float invslope2 = (v2.x - v0.x) / (v2.y - v0.y);
 
-		//float curx1 = v0.x;
-		//float curx2 = v0.x;
+		// Clip to scissor rect
+		int y0 = std::max(int(v0.y + 0.5f), setup.minY);
+		int y1 = std::min(int(v1.y + 0.5f), setup.maxY + 1);
 
-		#pragma omp parallel for
-		for (int scanlineY = int(v0.y + 0.5f); scanlineY < int(v1.y + 0.5f); scanlineY++)
-		{
-			float dy = (scanlineY - v0.y) + 0.5f;
-			float curx1 = v0.x + invslope1 * dy + 0.5f;
-			float curx2 = v0.x + invslope2 * dy + 0.5f;
+		m_threadPool->parallelFor(y1 - y0, SpanGrainSize, [&](int begin, int end) {
+			for (int scanlineY = y0 + begin; scanlineY < y0 + end; scanlineY++)
+			{
+				float dy = (scanlineY - v0.y) + 0.5f;
+				float curx1 = v0.x + invslope1 * dy + 0.5f;
+				float curx2 = v0.x + invslope2 * dy + 0.5f;
 
-			// Clip to scissor rect
-			int xl = std::max(m_minX, (int)curx1);
-			int xr = std::min(m_maxX, (int)curx2);
+				// Clip to scissor rect
+				int xl = std::max(setup.minX, (int)curx1);
+				int xr = std::min(setup.maxX + 1, (int)curx2);
 
-			PixelShader::drawSpan(eqn, xl, scanlineY, xr);
-			
-			// curx1 += invslope1;
-			// curx2 += invslope2;
-		}
+				pixelShader<PixelShader>().drawSpan(eqn, xl, scanlineY, xr, m_frameBuffer);
+			}
+		});
 	}
 
 	template <class PixelShader>
-	void drawTopFlatTriangle(const TriangleEquations &eqn, const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawTopFlatTriangle(const TriangleSetup &setup, const TriangleEquations &eqn, const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
 	{
 		float invslope1 = (v2.x - v0.x) / (v2.y - v0.y);
 		float invslope2 = (v2.x - v1.x) / (v2.y - v1.y);
 
-		// float curx1 = v2.x;
-		// float curx2 = v2.x;
+		// Clip to scissor rect
+		int y2 = std::min(int(v2.y - 0.5f), setup.maxY);
+		int y0 = std::max(int(v0.y - 0.5f), setup.minY - 1);
 
-		#pragma omp parallel for
-		for (int scanlineY = int(v2.y - 0.5f); scanlineY > int(v0.y - 0.5f); scanlineY--)
-		{
-			float dy = (scanlineY - v2.y) + 0.5f;
-			float curx1 = v2.x + invslope1 * dy + 0.5f;
-			float curx2 = v2.x + invslope2 * dy + 0.5f;
+		m_threadPool->parallelFor(y2 - y0, SpanGrainSize, [&](int begin, int end) {
+			for (int scanlineY = y2 - begin; scanlineY > y2 - end; scanlineY--)
+			{
+				float dy = (scanlineY - v2.y) + 0.5f;
+				float curx1 = v2.x + invslope1 * dy + 0.5f;
+				float curx2 = v2.x + invslope2 * dy + 0.5f;
 
-			// Clip to scissor rect
-			int xl = std::max(m_minX, (int)curx1);
-			int xr = std::min(m_maxX, (int)curx2);
+				// Clip to scissor rect
+				int xl = std::max(setup.minX, (int)curx1);
+				int xr = std::min(setup.maxX + 1, (int)curx2);
 
-			PixelShader::drawSpan(eqn, xl, scanlineY, xr);
-			// curx1 -= invslope1;
-			// curx2 -= invslope2;
-		}
+				pixelShader<PixelShader>().drawSpan(eqn, xl, scanlineY, xr, m_frameBuffer);
+			}
+		});
 	}
 
 	template <class PixelShader>
-	void drawTriangleAdaptiveTemplate(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawTriangleAdaptiveTemplate(const TriangleSetup &setup) const
 	{
-		// Compute triangle bounding box.
-		float minX = (float)std::min(std::min(v0.x, v1.x), v2.x);
-		float maxX = (float)std::max(std::max(v0.x, v1.x), v2.x);
-		float minY = (float)std::min(std::min(v0.y, v1.y), v2.y);
-		float maxY = (float)std::max(std::max(v0.y, v1.y), v2.y);
-
-		float orient = (maxX - minX) / (maxY - minY);
+		float orient = float(setup.maxX - setup.minX + 1) / float(setup.maxY - setup.minY + 1);
 
 		if (orient > 0.4 && orient < 1.6)
-			drawTriangleBlockTemplate<PixelShader>(v0, v1, v2);
+			drawTriangleBlockTemplate<PixelShader>(setup);
 		else
-			drawTriangleSpanTemplate<PixelShader>(v0, v1, v2);
+			drawTriangleSpanTemplate<PixelShader>(setup);
+	}
+
+	static bool isSmallTriangle(const TriangleSetup &setup)
+	{
+		return setup.maxX - setup.minX < BlockSize && setup.maxY - setup.minY < BlockSize;
 	}
 
 	template <class PixelShader>
-	void drawTriangleModeTemplate(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2) const
+	void drawSmallTrianglesTemplate(const TriangleSetup *setups, size_t count) const
 	{
-		switch (rasterMode)
+		for (size_t i = 0; i < count; ++i)
 		{
-			case RasterMode::Span:
-				drawTriangleSpanTemplate<PixelShader>(v0, v1, v2);
-				break;
-			case RasterMode::Block:
-				drawTriangleBlockTemplate<PixelShader>(v0, v1, v2);
-				break;
-			case RasterMode::Adaptive:
-				drawTriangleAdaptiveTemplate<PixelShader>(v0, v1, v2);
-				break;
+			const TriangleSetup &setup = setups[i];
+			TriangleEquations eqn(setup, PixelShader::AVarCount, PixelShader::PVarCount);
+			pixelShader<PixelShader>().drawSmallTriangle(eqn, setup.minX, setup.minY, setup.maxX, setup.maxY, m_frameBuffer);
+		}
+	}
+
+	template <class PixelShader>
+	void drawTriangleSetupListTemplate(const TriangleSetup *setups, size_t count) const
+	{
+		size_t i = 0;
+		while (i < count)
+		{
+			// Batch runs of small triangles. Runs are split at large
+			// triangles so the submission order is preserved.
+			size_t n = 0;
+			while (i + n < count && isSmallTriangle(setups[i + n]))
+				n++;
+
+			if (n > 0)
+			{
+				drawSmallTrianglesTemplate<PixelShader>(setups + i, n);
+				i += n;
+				continue;
+			}
+
+			switch (rasterMode)
+			{
+				case RasterMode::Span:
+					drawTriangleSpanTemplate<PixelShader>(setups[i]);
+					break;
+				case RasterMode::Block:
+					drawTriangleBlockTemplate<PixelShader>(setups[i]);
+					break;
+				case RasterMode::Adaptive:
+					drawTriangleAdaptiveTemplate<PixelShader>(setups[i]);
+					break;
+			}
+			i++;
 		}
 	}
 };
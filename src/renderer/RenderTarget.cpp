@@ -0,0 +1,167 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "RenderTarget.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+namespace swr {
+
+// Tiles start on a cache line boundary.
+static const size_t CacheLineSize = 64;
+
+const int RenderTarget::TileSize;
+
+RenderTarget::RenderTarget(int width, int height, RenderTargetFormat format)
+	: m_width(width)
+	, m_height(height)
+	, m_format(format)
+	, m_clearValue(0)
+{
+	assert(width > 0 && height > 0);
+
+	m_tilesX = (width + TileSize - 1) / TileSize;
+	m_tilesY = (height + TileSize - 1) / TileSize;
+	m_bytesPerPixel = bytesPerPixel(format);
+
+	size_t size = (size_t)m_tilesX * m_tilesY * tileBytes();
+	m_storage.resize(size + CacheLineSize);
+
+	size_t misalignment = (size_t)m_storage.data() % CacheLineSize;
+	m_data = m_storage.data() + (misalignment ? CacheLineSize - misalignment : 0);
+
+	size_t tileCount = (size_t)m_tilesX * m_tilesY;
+	m_tileState.reset(new std::atomic<unsigned char>[tileCount]);
+	for (size_t i = 0; i < tileCount; ++i)
+		m_tileState[i].store(TileValid, std::memory_order_relaxed);
+}
+
+int RenderTarget::bytesPerPixel(RenderTargetFormat format)
+{
+	switch (format)
+	{
+		case RenderTargetFormat::RGB565:
+			return 2;
+		case RenderTargetFormat::RGBA8:
+		case RenderTargetFormat::R32F:
+		case RenderTargetFormat::D32F:
+			return 4;
+	}
+
+	return 4;
+}
+
+void RenderTarget::clear(uint32_t value)
+{
+	// Relaxed stores are enough as clear() never overlaps a draw. The
+	// thread pool hands the new state to its workers when the next draw
+	// starts.
+	m_clearValue = value;
+
+	size_t tileCount = (size_t)m_tilesX * m_tilesY;
+	for (size_t i = 0; i < tileCount; ++i)
+		m_tileState[i].store(TileCleared, std::memory_order_relaxed);
+}
+
+void RenderTarget::clearDepth(float depth)
+{
+	assert(m_format == RenderTargetFormat::R32F || m_format == RenderTargetFormat::D32F);
+
+	uint32_t value;
+	std::memcpy(&value, &depth, sizeof(value));
+	clear(value);
+}
+
+void RenderTarget::resolve()
+{
+	size_t tileCount = (size_t)m_tilesX * m_tilesY;
+	for (size_t i = 0; i < tileCount; ++i)
+		if (m_tileState[i].load(std::memory_order_acquire) != TileValid)
+			materializeTile(i);
+}
+
+void RenderTarget::fillRow(unsigned char *dst, int pixels) const
+{
+	if (m_bytesPerPixel == 2)
+		std::fill_n((uint16_t*)dst, pixels, (uint16_t)m_clearValue);
+	else
+		std::fill_n((uint32_t*)dst, pixels, m_clearValue);
+}
+
+void RenderTarget::materializeTile(size_t index) const
+{
+	unsigned char expected = TileCleared;
+	if (m_tileState[index].compare_exchange_strong(expected, TileMaterializing, std::memory_order_acquire))
+	{
+		fillRow(m_data + index * tileBytes(), TileSize * TileSize);
+		m_tileState[index].store(TileValid, std::memory_order_release);
+		return;
+	}
+
+	// Another thread is filling the tile.
+	while (m_tileState[index].load(std::memory_order_acquire) != TileValid)
+		std::this_thread::yield();
+}
+
+void RenderTarget::copyToLinear(void *dst, int pitch) const
+{
+	size_t rowBytes = (size_t)TileSize * m_bytesPerPixel;
+
+	for (int ty = 0; ty < m_tilesY; ++ty)
+	{
+		int rows = std::min(TileSize, m_height - ty * TileSize);
+
+		for (int tx = 0; tx < m_tilesX; ++tx)
+		{
+			int columns = std::min(TileSize, m_width - tx * TileSize);
+			size_t bytes = (size_t)columns * m_bytesPerPixel;
+
+			unsigned char *d = (unsigned char*)dst + (size_t)ty * TileSize * pitch + (size_t)tx * rowBytes;
+
+			if (isTileCleared(tx, ty))
+			{
+				for (int y = 0; y < rows; ++y)
+				{
+					fillRow(d, columns);
+					d += pitch;
+				}
+				continue;
+			}
+
+			const unsigned char *src = m_data + ((size_t)ty * m_tilesX + tx) * tileBytes();
+
+			for (int y = 0; y < rows; ++y)
+			{
+				std::memcpy(d, src, bytes);
+				src += rowBytes;
+				d += pitch;
+			}
+		}
+	}
+}
+
+} // end namespace swr
@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "IRasterizer.h"
+
+namespace swr {
+
+/// Pixel formats of a RenderTarget.
+enum class RenderTargetFormat {
+	RGBA8,  ///< 32 bit color packed as 0xAARRGGBB.
+	RGB565, ///< 16 bit color.
+	R32F,   ///< 32 bit float.
+	D32F    ///< 32 bit float depth.
+};
+
+/// Tiled render target owned by the renderer.
+/** Pixels are stored in square tiles of TileSize x TileSize pixels, row by
+  row inside each tile. Tiles match the block grid of the rasterizer and
+  start on a cache line boundary, so blocks drawn by different threads
+  never share a cache line. The storage is padded to whole tiles.
+
+  Clearing only marks every tile as cleared. A cleared tile is filled with
+  the clear value the first time a pointer into it is requested, and
+  copyToLinear() writes the clear value of tiles that were never touched
+  without reading them. */
+class RenderTarget {
+public:
+	/// Edge length of a tile in pixels.
+	static const int TileSize = BlockSize;
+
+	/// Create a render target.
+	RenderTarget(int width, int height, RenderTargetFormat format);
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	RenderTargetFormat format() const { return m_format; }
+
+	/// Number of tiles in x direction.
+	int tilesX() const { return m_tilesX; }
+
+	/// Number of tiles in y direction.
+	int tilesY() const { return m_tilesY; }
+
+	/// Size of a single pixel in bytes.
+	int bytesPerPixel() const { return m_bytesPerPixel; }
+
+	/// Size of a single tile in bytes.
+	size_t tileBytes() const { return (size_t)m_bytesPerPixel * TileSize * TileSize; }
+
+	/// Pointer to the first pixel of tile (tx, ty).
+	/** Fills the tile with the clear value first if it is still cleared. */
+	unsigned char *tile(int tx, int ty)
+	{
+		size_t index = (size_t)ty * m_tilesX + tx;
+		if (m_tileState[index].load(std::memory_order_acquire) != TileValid)
+			materializeTile(index);
+		return m_data + index * tileBytes();
+	}
+
+	/// Pointer to the first pixel of tile (tx, ty).
+	const unsigned char *tile(int tx, int ty) const
+	{
+		size_t index = (size_t)ty * m_tilesX + tx;
+		if (m_tileState[index].load(std::memory_order_acquire) != TileValid)
+			materializeTile(index);
+		return m_data + index * tileBytes();
+	}
+
+	/// Pointer to pixel (x, y).
+	unsigned char *pixel(int x, int y)
+	{
+		return tile((unsigned)x / TileSize, (unsigned)y / TileSize) + tileOffset(x, y) * m_bytesPerPixel;
+	}
+
+	/// Pointer to pixel (x, y).
+	const unsigned char *pixel(int x, int y) const
+	{
+		return tile((unsigned)x / TileSize, (unsigned)y / TileSize) + tileOffset(x, y) * m_bytesPerPixel;
+	}
+
+	/// Offset of pixel (x, y) inside its tile, in pixels.
+	static int tileOffset(int x, int y)
+	{
+		return ((unsigned)y % TileSize) * TileSize + ((unsigned)x % TileSize);
+	}
+
+	/// Clear all pixels to a value in the format of the target.
+	/** RGBA8 takes 0xAARRGGBB, RGB565 the low 16 bits and the float formats
+	  the bit pattern of the float. Only the tile states are written.
+	  Must not be called while a draw to the target is running. */
+	void clear(uint32_t value);
+
+	/// Clear all pixels of a R32F or D32F target to the given value.
+	void clearDepth(float depth);
+
+	/// The value of the last clear.
+	uint32_t clearValue() const { return m_clearValue; }
+
+	/// Whether tile (tx, ty) has been cleared and not written since.
+	bool isTileCleared(int tx, int ty) const
+	{
+		return m_tileState[(size_t)ty * m_tilesX + tx].load(std::memory_order_acquire) != TileValid;
+	}
+
+	/// Fill all tiles that are still cleared with the clear value.
+	void resolve();
+
+	/// Copy the pixels to a linear buffer with the given pitch in bytes.
+	/** Tiles that are still cleared are written from the clear value. */
+	void copyToLinear(void *dst, int pitch) const;
+
+	/// Size of a pixel of the given format in bytes.
+	static int bytesPerPixel(RenderTargetFormat format);
+
+private:
+	enum TileState : unsigned char {
+		TileValid,
+		TileCleared,
+		TileMaterializing
+	};
+
+	void materializeTile(size_t index) const;
+	void fillRow(unsigned char *dst, int pixels) const;
+
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	int m_bytesPerPixel;
+	RenderTargetFormat m_format;
+
+	std::vector<unsigned char> m_storage;
+	unsigned char *m_data;
+
+	std::unique_ptr<std::atomic<unsigned char>[]> m_tileState;
+	uint32_t m_clearValue;
+};
+
+} // end namespace swr
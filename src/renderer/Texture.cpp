@@ -0,0 +1,553 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Texture.h"
+#include "BlockDecoder.h"
+#include "SimdConfig.h"
+#include "TextureReader.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace swr {
+
+namespace {
+
+const size_t CacheLineTexels = 64 / sizeof(uint32_t);
+
+bool powerOfTwo(int x)
+{
+	return (x & (x - 1)) == 0;
+}
+
+int log2Floor(int x)
+{
+	int n = 0;
+	while (x > 1)
+	{
+		x >>= 1;
+		n++;
+	}
+	return n;
+}
+
+uint64_t nextTextureId()
+{
+	// Ids start at 1, so that no tag matches an empty cache entry.
+	static std::atomic<uint64_t> counter(0);
+	return ++counter;
+}
+
+// Separable filter weights for one axis. Destination texel i is the sum of
+// weight[i * taps + k] times source texel index[i * taps + k].
+struct AxisFilter {
+	int taps;
+	std::vector<int> index;
+	std::vector<float> weight;
+};
+
+const float KaiserRadius = 3.0f;
+const float KaiserAlpha = 4.0f;
+
+// Modified Bessel function of the first kind of order 0.
+double bessel0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 32; ++k)
+	{
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// t is the distance in destination texels.
+double kaiser(double t)
+{
+	if (std::abs(t) >= KaiserRadius)
+		return 0.0;
+
+	double pt = 3.14159265358979323846 * t;
+	double sinc = pt == 0.0 ? 1.0 : std::sin(pt) / pt;
+	double r = t / KaiserRadius;
+	return sinc * bessel0(KaiserAlpha * std::sqrt(1.0 - r * r)) / bessel0(KaiserAlpha);
+}
+
+AxisFilter axisFilter(int srcSize, int dstSize, MipmapFilter filter)
+{
+	AxisFilter result;
+	double scale = (double)srcSize / dstSize;
+
+	std::vector<std::vector<std::pair<int, double> > > taps(dstSize);
+
+	for (int i = 0; i < dstSize; ++i)
+	{
+		double lo = i * scale;
+		double hi = lo + scale;
+
+		if (filter == MipmapFilter::Box)
+		{
+			// Overlap of each source texel with the destination texel. For
+			// odd sizes the source texels at the borders are shared.
+			for (int s = (int)lo; s < hi; ++s)
+			{
+				double overlap = std::min(hi, s + 1.0) - std::max(lo, (double)s);
+				if (overlap > 1e-9)
+					taps[i].push_back(std::make_pair(s, overlap));
+			}
+		}
+		else
+		{
+			double center = lo + scale * 0.5;
+			int first = (int)std::floor(center - KaiserRadius * scale);
+			int last = (int)std::ceil(center + KaiserRadius * scale);
+			for (int s = first; s <= last; ++s)
+			{
+				double w = kaiser((s + 0.5 - center) / scale);
+				if (w != 0.0)
+					taps[i].push_back(std::make_pair(((s % srcSize) + srcSize) % srcSize, w));
+			}
+		}
+	}
+
+	result.taps = 0;
+	for (auto &t : taps)
+		result.taps = std::max(result.taps, (int)t.size());
+
+	// Pad to the same number of taps with zero weights
+	result.index.assign((size_t)dstSize * result.taps, 0);
+	result.weight.assign((size_t)dstSize * result.taps, 0.0f);
+
+	for (int i = 0; i < dstSize; ++i)
+	{
+		double sum = 0.0;
+		for (auto &t : taps[i])
+			sum += t.second;
+
+		for (size_t k = 0; k < taps[i].size(); ++k)
+		{
+			result.index[(size_t)i * result.taps + k] = taps[i][k].first;
+			result.weight[(size_t)i * result.taps + k] = (float)(taps[i][k].second / sum);
+		}
+	}
+
+	return result;
+}
+
+// Conversion between 8 bit sRGB and linear [0, 1].
+struct SRGBTables {
+	static const int EncodeSize = 4096;
+
+	float decode[256];
+	unsigned char encode[EncodeSize];
+
+	SRGBTables()
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			double c = i / 255.0;
+			decode[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+		}
+
+		for (int i = 0; i < EncodeSize; ++i)
+		{
+			double c = (double)i / (EncodeSize - 1);
+			c = c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+			encode[i] = (unsigned char)(c * 255.0 + 0.5);
+		}
+	}
+
+	static const SRGBTables &instance()
+	{
+		static const SRGBTables tables;
+		return tables;
+	}
+};
+
+// Four float channels of a texel in the order b, g, r, a.
+#ifdef SWR_USE_SSE2
+typedef __m128 Channels;
+
+Channels zeroChannels() { return _mm_setzero_ps(); }
+
+Channels loadChannels(const float *p) { return _mm_loadu_ps(p); }
+
+void storeChannels(float *p, Channels c) { _mm_storeu_ps(p, c); }
+
+Channels multiplyAdd(Channels sum, Channels c, float w)
+{
+	return _mm_add_ps(sum, _mm_mul_ps(c, _mm_set1_ps(w)));
+}
+
+Channels unpackTexel(uint32_t texel)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)texel), zero), zero);
+	return _mm_cvtepi32_ps(c);
+}
+
+uint32_t packTexel(Channels c)
+{
+	// Round half up, clamp to [0, 255] and pack
+	__m128i i = _mm_cvttps_epi32(_mm_add_ps(c, _mm_set1_ps(0.5f)));
+	i = _mm_packs_epi32(i, i);
+	return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+}
+#else
+struct Channels {
+	float v[4];
+};
+
+Channels zeroChannels()
+{
+	Channels c = { { 0, 0, 0, 0 } };
+	return c;
+}
+
+Channels loadChannels(const float *p)
+{
+	Channels c = { { p[0], p[1], p[2], p[3] } };
+	return c;
+}
+
+void storeChannels(float *p, Channels c)
+{
+	for (int i = 0; i < 4; ++i)
+		p[i] = c.v[i];
+}
+
+Channels multiplyAdd(Channels sum, Channels c, float w)
+{
+	for (int i = 0; i < 4; ++i)
+		sum.v[i] += c.v[i] * w;
+	return sum;
+}
+
+Channels unpackTexel(uint32_t texel)
+{
+	Channels c;
+	for (int i = 0; i < 4; ++i)
+		c.v[i] = (float)((texel >> (i * 8)) & 0xff);
+	return c;
+}
+
+uint32_t packTexel(Channels c)
+{
+	uint32_t texel = 0;
+	for (int i = 0; i < 4; ++i)
+		texel |= (uint32_t)std::min(std::max((int)(c.v[i] + 0.5f), 0), 255) << (i * 8);
+	return texel;
+}
+#endif
+
+Channels decodeTexel(uint32_t texel, bool sRGB, const SRGBTables &tables)
+{
+	if (!sRGB)
+		return unpackTexel(texel);
+
+	// Color channels to linear scaled to [0, 255] like the alpha channel
+	float linear[4] = {
+		tables.decode[texel & 0xff] * 255.0f,
+		tables.decode[(texel >> 8) & 0xff] * 255.0f,
+		tables.decode[(texel >> 16) & 0xff] * 255.0f,
+		(float)(texel >> 24)
+	};
+	return loadChannels(linear);
+}
+
+uint32_t encodeTexel(Channels c, bool sRGB, const SRGBTables &tables)
+{
+	uint32_t texel = packTexel(c);
+	if (!sRGB)
+		return texel;
+
+	float linear[4];
+	storeChannels(linear, c);
+
+	const float scale = (SRGBTables::EncodeSize - 1) / 255.0f;
+	uint32_t result = texel & 0xff000000;
+	for (int i = 0; i < 3; ++i)
+	{
+		int index = std::min(std::max((int)(linear[i] * scale + 0.5f), 0), SRGBTables::EncodeSize - 1);
+		result |= (uint32_t)tables.encode[index] << (i * 8);
+	}
+	return result;
+}
+
+} // end anonymous namespace
+
+const int Texture::MaxAnisotropy;
+const int Texture::TileSize;
+const int Texture::DecodedBlockCacheSize;
+
+std::atomic<AnisotropicQuality> Texture::s_anisotropicQuality(AnisotropicQuality::High);
+std::atomic<int> Texture::s_anisotropicBudget(Texture::MaxAnisotropy);
+
+// Weights of taps spread evenly over the major axis. They are a Gaussian
+// exp(-x^2) with x in [-1, 1] over the axis, rounded to sum up to 256.
+const int Texture::s_anisotropicWeights[MaxAnisotropy + 1][MaxAnisotropy] = {
+	{0},
+	{256},
+	{128, 128},
+	{72, 112, 72},
+	{48, 80, 80, 48},
+	{36, 58, 68, 58, 36},
+	{28, 44, 56, 56, 44, 28},
+	{23, 35, 45, 50, 45, 35, 23},
+	{20, 29, 37, 42, 42, 37, 29, 20},
+	{17, 24, 31, 37, 38, 37, 31, 24, 17},
+	{15, 21, 27, 31, 34, 34, 31, 27, 21, 15},
+	{14, 18, 23, 27, 30, 32, 30, 27, 23, 18, 14},
+	{12, 16, 20, 24, 27, 29, 29, 27, 24, 20, 16, 12},
+	{11, 15, 18, 21, 24, 26, 26, 26, 24, 21, 18, 15, 11},
+	{10, 13, 16, 19, 22, 23, 25, 25, 23, 22, 19, 16, 13, 10},
+	{10, 12, 15, 17, 19, 21, 22, 24, 22, 21, 19, 17, 15, 12, 10},
+	{9, 11, 13, 16, 18, 19, 21, 21, 21, 21, 19, 18, 16, 13, 11, 9},
+};
+
+void Texture::setAnisotropicQuality(AnisotropicQuality quality)
+{
+	s_anisotropicQuality.store(quality, std::memory_order_relaxed);
+	s_anisotropicBudget.store(quality == AnisotropicQuality::Low ? 4
+		: quality == AnisotropicQuality::Medium ? 8 : MaxAnisotropy, std::memory_order_relaxed);
+}
+
+Texture::Texture(const uint32_t *pixels, int width, int height, int pitch, int maxAnisotropy)
+	: Texture(pixels, width, height, pitch, MipmapSettings(), maxAnisotropy)
+{
+}
+
+Texture::Texture(const uint32_t *pixels, int width, int height, int pitch, const MipmapSettings &mipmaps, int maxAnisotropy)
+	: m_format(TextureFormat::XRGB8)
+	, m_id(nextTextureId())
+	, m_powerOfTwo(powerOfTwo(width) && powerOfTwo(height))
+	, m_maxAnisotropy(std::min(std::max(maxAnisotropy, 1), MaxAnisotropy))
+{
+	assert(pixels && width > 0 && height > 0);
+
+	layoutLevels(width, height, 0, TileSize * TileSize);
+
+	const Level &base = m_levels[0];
+	for (int y = 0; y < height; ++y)
+	{
+		const uint32_t *row = (const uint32_t*)((const unsigned char*)pixels + (size_t)y * pitch);
+		for (int x = 0; x < width; ++x)
+			m_texels[texelIndex(base, x, y)] = row[x];
+	}
+
+	generateMipmaps(mipmaps);
+}
+
+Texture::Texture(const CompressedImage &image, int maxAnisotropy)
+	: m_format(image.format)
+	, m_id(nextTextureId())
+	, m_powerOfTwo(powerOfTwo(image.width) && powerOfTwo(image.height))
+	, m_maxAnisotropy(std::min(std::max(maxAnisotropy, 1), MaxAnisotropy))
+{
+	assert(image.format != TextureFormat::XRGB8 && image.width > 0 && image.height > 0);
+	assert(!image.levels.empty());
+
+	// Blocks take the place of tiles, offsets count blocks.
+	layoutLevels(image.width, image.height, (int)image.levels.size(), 1);
+
+	size_t bytes = blockBytes(m_format);
+	unsigned char *blocks = (unsigned char*)m_texels;
+
+	for (size_t i = 0; i < m_levels.size(); ++i)
+	{
+		const Level &level = m_levels[i];
+		size_t blockCount = (size_t)level.tilesX * ((level.height + TileSize - 1) / TileSize);
+		assert(image.levels[i].size() == blockCount * bytes);
+		std::memcpy(blocks + level.offset * bytes, image.levels[i].data(), blockCount * bytes);
+	}
+}
+
+// Lay out levelCount levels, or the whole mip chain down to 1x1 if
+// levelCount is 0, in a single allocation. Each tile takes unitsPerTile
+// uint32_t for XRGB8 or one block for compressed formats.
+void Texture::layoutLevels(int width, int height, int levelCount, size_t unitsPerTile)
+{
+	size_t tileCount = 0;
+	int w = width;
+	int h = height;
+	for (;;)
+	{
+		Level level;
+		level.width = w;
+		level.height = h;
+		level.tilesX = (w + TileSize - 1) / TileSize;
+		level.tileShiftX = log2Floor(level.tilesX);
+		level.offset = tileCount * unitsPerTile;
+		m_levels.push_back(level);
+
+		int tilesY = (h + TileSize - 1) / TileSize;
+		tileCount += (size_t)level.tilesX * tilesY;
+
+		if ((w == 1 && h == 1) || (int)m_levels.size() == levelCount)
+			break;
+
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+
+	size_t bytesPerTile = m_format == TextureFormat::XRGB8 ? unitsPerTile * sizeof(uint32_t) : blockBytes(m_format);
+	size_t texelCount = (tileCount * bytesPerTile + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+	m_storage.resize(texelCount + CacheLineTexels);
+	size_t misalignment = ((uintptr_t)m_storage.data() / sizeof(uint32_t)) % CacheLineTexels;
+	m_texels = m_storage.data() + (misalignment ? CacheLineTexels - misalignment : 0);
+}
+
+void Texture::decodeBlock(size_t block, uint32_t *texels) const
+{
+	const unsigned char *data = (const unsigned char*)m_texels + block * blockBytes(m_format);
+
+	switch (m_format)
+	{
+		case TextureFormat::BC1: decodeBC1(data, texels); break;
+		case TextureFormat::BC3: decodeBC3(data, texels); break;
+		case TextureFormat::BC4: decodeBC4(data, texels); break;
+		case TextureFormat::BC5: decodeBC5(data, texels); break;
+		default: assert(false); break;
+	}
+}
+
+// Each level is filtered from the previous one, first vertically into a
+// row of source width and then horizontally. Rows are distributed over
+// the thread pool.
+void Texture::generateMipmaps(const MipmapSettings &settings)
+{
+	ThreadPool *pool = settings.threadPool ? settings.threadPool : ThreadPool::defaultPool();
+	const SRGBTables &tables = SRGBTables::instance();
+	bool sRGB = settings.sRGB;
+
+	for (size_t i = 1; i < m_levels.size(); ++i)
+	{
+		const Level &src = m_levels[i - 1];
+		const Level &dst = m_levels[i];
+
+		int grainSize = std::max(1, 16384 / std::max(src.width, 1));
+
+		// Plain averages of 2x2 texels have a faster path.
+		if (settings.filter == MipmapFilter::Box && !sRGB && src.width == dst.width * 2 && src.height == dst.height * 2)
+		{
+			pool->parallelFor(dst.height, grainSize, [&](int begin, int end) {
+				halveRows(src, dst, begin, end);
+			});
+			continue;
+		}
+
+		AxisFilter filterX = axisFilter(src.width, dst.width, settings.filter);
+		AxisFilter filterY = axisFilter(src.height, dst.height, settings.filter);
+
+		pool->parallelFor(dst.height, grainSize, [&](int begin, int end) {
+			std::vector<float> column((size_t)src.width * 4);
+
+			for (int y = begin; y < end; ++y)
+			{
+				const int *rows = &filterY.index[(size_t)y * filterY.taps];
+				const float *rowWeights = &filterY.weight[(size_t)y * filterY.taps];
+
+				for (int x = 0; x < src.width; ++x)
+				{
+					Channels sum = zeroChannels();
+					for (int k = 0; k < filterY.taps; ++k)
+					{
+						uint32_t texel = m_texels[texelIndex(src, x, rows[k])];
+						sum = multiplyAdd(sum, decodeTexel(texel, sRGB, tables), rowWeights[k]);
+					}
+					storeChannels(&column[(size_t)x * 4], sum);
+				}
+
+				for (int x = 0; x < dst.width; ++x)
+				{
+					const int *columns = &filterX.index[(size_t)x * filterX.taps];
+					const float *columnWeights = &filterX.weight[(size_t)x * filterX.taps];
+
+					Channels sum = zeroChannels();
+					for (int k = 0; k < filterX.taps; ++k)
+						sum = multiplyAdd(sum, loadChannels(&column[(size_t)columns[k] * 4]), columnWeights[k]);
+
+					m_texels[texelIndex(dst, x, y)] = encodeTexel(sum, sRGB, tables);
+				}
+			}
+		});
+	}
+}
+
+// Rows [begin, end) of dst as the rounded average of 2x2 texels of src.
+// Four texels of a source row are contiguous inside a tile and give two
+// contiguous destination texels.
+void Texture::halveRows(const Level &src, const Level &dst, int begin, int end)
+{
+	for (int y = begin; y < end; ++y)
+	{
+		const uint32_t *row0 = m_texels + rowOffset(src, y * 2);
+		const uint32_t *row1 = m_texels + rowOffset(src, y * 2 + 1);
+		uint32_t *out = m_texels + rowOffset(dst, y);
+
+		int x = 0;
+
+#ifdef SWR_USE_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(2);
+
+		for (; x + 4 <= src.width; x += 4)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + columnOffset(x)));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row1 + columnOffset(x)));
+
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+			__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+			_mm_storel_epi64((__m128i*)(out + columnOffset(x / 2)), _mm_packus_epi16(sum, sum));
+		}
+#endif
+
+		for (; x < src.width; x += 2)
+		{
+			uint32_t p00 = row0[columnOffset(x)];
+			uint32_t p10 = row0[columnOffset(x + 1)];
+			uint32_t p01 = row1[columnOffset(x)];
+			uint32_t p11 = row1[columnOffset(x + 1)];
+
+			uint32_t texel = 0;
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				uint32_t sum = ((p00 >> shift) & 0xff) + ((p10 >> shift) & 0xff) + ((p01 >> shift) & 0xff) + ((p11 >> shift) & 0xff);
+				texel |= ((sum + 2) >> 2) << shift;
+			}
+			out[columnOffset(x / 2)] = texel;
+		}
+	}
+}
+
+} // end namespace swr
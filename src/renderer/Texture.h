@@ -0,0 +1,579 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include "SimdConfig.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace swr {
+
+/// Texture coordinate handling outside of [0, 1].
+enum class AddressMode {
+	Wrap,
+	Clamp,
+	Mirror
+};
+
+/// Texel storage formats.
+enum class TextureFormat {
+	XRGB8, ///< 32 bit 0xAARRGGBB texels.
+	BC1,   ///< 8 byte blocks with RGB and 1 bit alpha.
+	BC3,   ///< 16 byte blocks with RGB and 8 bit alpha.
+	BC4,   ///< 8 byte blocks with one channel, sampled as red.
+	BC5    ///< 16 byte blocks with two channels, sampled as red and green.
+};
+
+class ThreadPool;
+
+/// Filter used to build mip levels.
+enum class MipmapFilter {
+	Box,   ///< Area weighted average, also exact for odd sizes.
+	Kaiser ///< Kaiser windowed sinc, sharper than Box. Wraps around the edges.
+};
+
+/// How the mip chain of a texture is built.
+struct MipmapSettings {
+	MipmapFilter filter;
+
+	/// Texels are sRGB encoded and are filtered in linear space. Alpha is linear.
+	bool sRGB;
+
+	/// Pool for filtering rows in parallel, nullptr for ThreadPool::defaultPool().
+	ThreadPool *threadPool;
+
+	MipmapSettings() : filter(MipmapFilter::Box), sRGB(false), threadPool(nullptr) {}
+};
+
+struct CompressedImage;
+
+/// Global trade off between anisotropic filtering quality and speed.
+/** Limits the number of anisotropic taps on the finer mip level to 4, 8
+  or 16, or the maxAnisotropy of the texture if that is lower. Footprints
+  longer than that are filtered from coarser mip levels. */
+enum class AnisotropicQuality {
+	Low,
+	Medium,
+	High
+};
+
+/// Filter footprint of a pixel, see Texture::footprint().
+struct TextureFootprint {
+	float lod;    ///< Mip level, the taps are blended between its floor and ceil.
+	float majorU; ///< Major axis of the footprint along u.
+	float majorV; ///< Major axis of the footprint along v.
+	int taps;     ///< Anisotropic taps on the finer level, the coarser one takes half.
+};
+
+/// Mipmapped texture with trilinear and anisotropic filtering.
+/** All mip levels live in one contiguous allocation. Texels are stored in
+  tiles of TileSize x TileSize, row by row inside each tile, so the four
+  texels of a bilinear fetch are usually in the same cache line even for
+  rotated or minified access. Levels of power of two textures are
+  addressed with shifts only.
+
+  Colors are 0xAARRGGBB. Filtering works on the color channels and the
+  sampled alpha is always 0. Filter weights are 8 bit fixed point and the
+  four texels of a bilinear fetch are filtered together in one SSE2
+  register where available.
+
+  Block compressed textures keep their 4x4 blocks in place of the tiles
+  and are sampled without decompressing them up front. Decoded blocks
+  are kept in a small direct mapped cache per thread. */
+class Texture {
+public:
+	/// Upper limit of the number of anisotropic samples.
+	static const int MaxAnisotropy = 16;
+
+	/// Set the anisotropic filtering quality of all textures.
+	/** Draws in flight may still use the previous setting for some pixels.
+	  The default is High. */
+	static void setAnisotropicQuality(AnisotropicQuality quality);
+
+	static AnisotropicQuality anisotropicQuality() { return s_anisotropicQuality.load(std::memory_order_relaxed); }
+
+	/// Edge length of a texel tile, which is also the size of compressed blocks.
+	static const int TileSize = 4;
+
+	/// Number of decoded blocks cached per thread.
+	static const int DecodedBlockCacheSize = 64;
+
+	/// Create a texture and its mip chain.
+	/** pixels holds width x height colors with pitch bytes per row. */
+	Texture(const uint32_t *pixels, int width, int height, int pitch, int maxAnisotropy = 8);
+
+	/// Create a texture and build its mip chain with the given settings.
+	Texture(const uint32_t *pixels, int width, int height, int pitch, const MipmapSettings &mipmaps, int maxAnisotropy = 8);
+
+	/// Create a block compressed texture.
+	/** The mip levels of the image are used as they are, there may be fewer
+	  than down to 1x1. */
+	Texture(const CompressedImage &image, int maxAnisotropy = 8);
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	int width(int level = 0) const { return m_levels[level].width; }
+	int height(int level = 0) const { return m_levels[level].height; }
+
+	/// Number of mip levels.
+	int levelCount() const { return (int)m_levels.size(); }
+
+	TextureFormat format() const { return m_format; }
+
+	/// Bytes per 4x4 block of a compressed format, or per texel for XRGB8.
+	static int blockBytes(TextureFormat format)
+	{
+		return format == TextureFormat::XRGB8 ? 4
+			: format == TextureFormat::BC1 || format == TextureFormat::BC4 ? 8 : 16;
+	}
+
+	/// Whether width and height are powers of two.
+	bool isPowerOfTwo() const { return m_powerOfTwo; }
+
+	/// Texel (x, y) of a mip level.
+	uint32_t texel(int level, int x, int y) const
+	{
+		if (m_format != TextureFormat::XRGB8)
+			return compressedTexel(level, x, y);
+		return m_texels[texelIndex(m_levels[level], x, y)];
+	}
+
+	/// Filter footprint for the screen space derivatives of u and v.
+	/** The footprint is approximated by an ellipse. Anisotropic taps are
+	  placed along its major axis, with weights from a precomputed table
+	  that fall off towards the ends. The mip level follows the minor axis
+	  unless the tap budget of maxAnisotropy and the AnisotropicQuality is
+	  exceeded. The footprint changes slowly across a triangle, so shaders
+	  can compute it once for several neighbouring pixels, see
+	  PixelShaderBase::SegmentSize. */
+	TextureFootprint footprint(float dudx, float dvdx, float dudy, float dvdy) const
+	{
+		const Level &base = m_levels[0];
+
+		// Compute ellipse axes
+		float dudxScaled = dudx * base.width;
+		float dvdxScaled = dvdx * base.height;
+		float dudyScaled = dudy * base.width;
+		float dvdyScaled = dvdy * base.height;
+
+		float dxLen = std::sqrt(dudxScaled * dudxScaled + dvdxScaled * dvdxScaled);
+		float dyLen = std::sqrt(dudyScaled * dudyScaled + dvdyScaled * dvdyScaled);
+
+		dxLen = std::max(dxLen, 1e-6f);
+		dyLen = std::max(dyLen, 1e-6f);
+
+		float majorLen = std::max(dxLen, dyLen);
+		float minorLen = std::min(dxLen, dyLen);
+
+		TextureFootprint result;
+		result.majorU = dxLen > dyLen ? dudx : dudy;
+		result.majorV = dxLen > dyLen ? dvdx : dvdy;
+
+		// ratio is at least 1, so this is ceil
+		int budget = std::min(m_maxAnisotropy, s_anisotropicBudget.load(std::memory_order_relaxed));
+		float ratio = majorLen / minorLen;
+		int taps = static_cast<int>(std::min(ratio, static_cast<float>(budget)));
+		taps += taps < ratio && taps < budget;
+
+		if (taps <= 1)
+		{
+			// Regular trilinear filtering for low anisotropy
+			result.lod = levelOfDetail(majorLen);
+			result.taps = 1;
+			return result;
+		}
+
+		// Footprints longer than the budget move to a coarser level, which
+		// keeps the tap spacing below two texels there. The taps are snapped
+		// to the texel grid in sampleTaps().
+		result.lod = levelOfDetail(std::max(minorLen, majorLen / budget));
+		result.taps = taps;
+		return result;
+	}
+
+	/// Sample the texture with the screen space derivatives of u and v.
+	/** Coordinates wrap around. */
+	void sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy, uint32_t &outColor) const
+	{
+		sample<AddressMode::Wrap, AddressMode::Wrap>(u, v, footprint(dudx, dvdx, dudy, dvdy), outColor);
+	}
+
+	/// Sample the texture with a footprint from footprint().
+	/** Coordinates wrap around. */
+	void sample(float u, float v, const TextureFootprint &fp, uint32_t &outColor) const
+	{
+		sample<AddressMode::Wrap, AddressMode::Wrap>(u, v, fp, outColor);
+	}
+
+	/// Sample the texture with compile time address modes for u and v.
+	template <AddressMode AddressU, AddressMode AddressV = AddressU>
+	void sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy, uint32_t &outColor) const
+	{
+		sample<AddressU, AddressV>(u, v, footprint(dudx, dvdx, dudy, dvdy), outColor);
+	}
+
+	/// Sample the texture with compile time address modes and a footprint.
+	template <AddressMode AddressU, AddressMode AddressV = AddressU>
+	void sample(float u, float v, const TextureFootprint &fp, uint32_t &outColor) const
+	{
+		if (m_format == TextureFormat::XRGB8)
+			sampleFootprint<false, AddressU, AddressV>(u, v, fp, outColor);
+		else
+			sampleFootprint<true, AddressU, AddressV>(u, v, fp, outColor);
+	}
+
+private:
+	static std::atomic<AnisotropicQuality> s_anisotropicQuality;
+	static std::atomic<int> s_anisotropicBudget;
+
+	// 8 bit weights of n anisotropic taps, falling off towards the ends.
+	static const int s_anisotropicWeights[MaxAnisotropy + 1][MaxAnisotropy];
+
+	// The trilinear blend is done on the sums of the taps of each level.
+	// The coarser level covers the same axis with half the texels and so
+	// takes half the taps, which are spaced like the ones on the finer level.
+	template <bool Compressed, AddressMode AddressU, AddressMode AddressV>
+	void sampleFootprint(float u, float v, const TextureFootprint &fp, uint32_t &outColor) const
+	{
+		int lodBase = static_cast<int>(fp.lod);
+		int lodNext = std::min(lodBase + 1, static_cast<int>(m_levels.size()) - 1);
+		int t = static_cast<int>((fp.lod - lodBase) * 256.0f);
+
+		outColor = sampleTaps<Compressed, AddressU, AddressV>(lodBase, u, v, fp, fp.taps);
+		if (lodBase != lodNext && t > 0)
+		{
+			uint32_t colorNext = sampleTaps<Compressed, AddressU, AddressV>(lodNext, u, v, fp, (fp.taps + 1) >> 1);
+			outColor = lerpColors(outColor, colorNext, t);
+		}
+	}
+
+	template <bool Compressed, AddressMode AddressU, AddressMode AddressV>
+	uint32_t sampleTaps(int levelIndex, float u, float v, const TextureFootprint &fp, int taps) const
+	{
+		uint32_t color;
+		if (taps <= 1)
+		{
+			sampleBilinear<Compressed, AddressU, AddressV>(levelIndex, addressCoordinate<AddressU>(u), addressCoordinate<AddressV>(v), color);
+			return color;
+		}
+
+		// Taps are snapped to the texel grid of this level along the axis
+		// the major axis mostly runs along. They are one texel apart on
+		// texel centers, or two texels apart halfway between centers so each
+		// bilinear tap averages both. Either way neighbouring taps share
+		// texels and no texel along the axis is skipped. The weights come
+		// from the table for the snapped tap count, which is at most taps.
+		const Level &level = m_levels[levelIndex];
+		float majorX = fp.majorU * level.width;
+		float majorY = fp.majorV * level.height;
+		bool alongU = std::fabs(majorX) >= std::fabs(majorY);
+		float length = alongU ? majorX : majorY;
+		float center = alongU ? u * level.width - 0.5f : v * level.height - 0.5f;
+
+		int spacing = 1;
+		int count = static_cast<int>(std::fabs(length) + 0.5f);
+		if (count > taps)
+		{
+			spacing = 2;
+			count = std::min(taps, static_cast<int>(std::fabs(length) * 0.5f + 0.5f));
+		}
+
+		if (count <= 1)
+			return sampleTaps<Compressed, AddressU, AddressV>(levelIndex, u, v, fp, 1);
+
+		float first = center - 0.5f * (count - 1) * spacing;
+		first = spacing == 1 ? fastFloor(first + 0.5f) : fastFloor(first) + 0.5f;
+
+		// Tap offsets in units of the major axis
+		float offset = (first - center) / length;
+		float offsetStep = spacing / length;
+
+		const int *weights = s_anisotropicWeights[count];
+		int r = 128, g = 128, b = 128;
+
+		for (int i = 0; i < count; ++i, offset += offsetStep)
+		{
+			float su = addressCoordinate<AddressU>(u + fp.majorU * offset);
+			float sv = addressCoordinate<AddressV>(v + fp.majorV * offset);
+			sampleBilinear<Compressed, AddressU, AddressV>(levelIndex, su, sv, color);
+
+			int w = weights[i];
+			r += getR(color) * w;
+			g += getG(color) * w;
+			b += getB(color) * w;
+		}
+
+		return packRGB(r >> 8, g >> 8, b >> 8);
+	}
+
+	struct Level {
+		int width;
+		int height;
+		int tilesX;
+		int tileShiftX;   // log2(tilesX) for power of two textures
+		size_t offset;    // index of the first texel, or block if compressed
+	};
+
+	struct DecodedBlock {
+		uint64_t tag;
+		uint32_t texels[TileSize * TileSize];
+	};
+
+	// Index of the first tile in the tile row of y
+	size_t tileRow(const Level &level, int y) const
+	{
+		return m_powerOfTwo
+			? (size_t)(y >> 2) << level.tileShiftX
+			: (size_t)(y >> 2) * level.tilesX;
+	}
+
+	// Texel indices are the sum of a row and a column part.
+	size_t rowOffset(const Level &level, int y) const
+	{
+		return level.offset + (tileRow(level, y) << 4) + ((y & 3) << 2);
+	}
+
+	static size_t columnOffset(int x)
+	{
+		return ((size_t)(x >> 2) << 4) + (x & 3);
+	}
+
+	size_t texelIndex(const Level &level, int x, int y) const
+	{
+		return rowOffset(level, y) + columnOffset(x);
+	}
+
+	template <bool Compressed, AddressMode AddressU, AddressMode AddressV>
+	void sampleBilinear(int levelIndex, float u, float v, uint32_t &outColor) const
+	{
+		const Level &level = m_levels[levelIndex];
+
+		int x0, x1, fx;
+		int y0, y1, fy;
+		addressTexels<AddressU>(u, level.width, x0, x1, fx);
+		addressTexels<AddressV>(v, level.height, y0, y1, fy);
+
+		if (Compressed)
+		{
+			uint32_t c00 = compressedTexel(levelIndex, x0, y0);
+			uint32_t c10 = compressedTexel(levelIndex, x1, y0);
+			uint32_t c01 = compressedTexel(levelIndex, x0, y1);
+			uint32_t c11 = compressedTexel(levelIndex, x1, y1);
+			outColor = bilinearLerpColors(c00, c10, c01, c11, fx, fy);
+			return;
+		}
+
+		const uint32_t *row0 = m_texels + rowOffset(level, y0);
+		const uint32_t *row1 = m_texels + rowOffset(level, y1);
+		size_t col0 = columnOffset(x0);
+		size_t col1 = columnOffset(x1);
+
+		outColor = bilinearLerpColors(row0[col0], row0[col1], row1[col0], row1[col1], fx, fy);
+	}
+
+	uint32_t compressedTexel(int levelIndex, int x, int y) const
+	{
+		const Level &level = m_levels[levelIndex];
+		size_t block = level.offset + tileRow(level, y) + (x >> 2);
+
+		// The slot depends on the block position, so that 8x4 blocks of
+		// two adjacent levels fit in the cache together.
+		static thread_local DecodedBlock cache[DecodedBlockCacheSize];
+		DecodedBlock &entry = cache[((x >> 2) & 7) | ((y >> 2) & 3) << 3 | (levelIndex & 1) << 5];
+
+		uint64_t tag = m_id << 40 | block;
+		if (entry.tag != tag)
+		{
+			decodeBlock(block, entry.texels);
+			entry.tag = tag;
+		}
+
+		return entry.texels[(y & 3) << 2 | (x & 3)];
+	}
+
+	void decodeBlock(size_t block, uint32_t *texels) const;
+
+	/// Map a texture coordinate to [0, 1] according to the address mode.
+	template <AddressMode Mode>
+	static float addressCoordinate(float s)
+	{
+		if (Mode == AddressMode::Wrap)
+		{
+			s -= fastFloor(s);
+		}
+		else if (Mode == AddressMode::Mirror)
+		{
+			s -= 2.0f * fastFloor(s * 0.5f);
+			if (s > 1.0f) s = 2.0f - s;
+		}
+
+		// Written so that NaN and infinite coordinates also end up in [0, 1].
+		return std::max(0.0f, std::min(s, 1.0f));
+	}
+
+	/// Find the two texels around s in [0, 1] and the 8 bit weight of the second.
+	/** Texel i is centered at (i + 0.5) / size. */
+	template <AddressMode Mode>
+	void addressTexels(float s, int size, int &i0, int &i1, int &weight) const
+	{
+		float p = s * size - 0.5f;
+		int i = static_cast<int>(fastFloor(p));
+		weight = static_cast<int>((p - i) * 256.0f);
+
+		// i is in [-1, size - 1]
+		if (Mode != AddressMode::Wrap)
+		{
+			i0 = std::max(i, 0);
+			i1 = std::min(i + 1, size - 1);
+		}
+		else if (m_powerOfTwo)
+		{
+			i0 = i & (size - 1);
+			i1 = (i + 1) & (size - 1);
+		}
+		else
+		{
+			i0 = i < 0 ? size - 1 : i;
+			i1 = i + 1 < size ? i + 1 : 0;
+		}
+	}
+
+	/// Floor that maps NaN to 0.
+	static float fastFloor(float x)
+	{
+		// Floats from 2^23 on have no fraction, and converting them to int
+		// could overflow.
+		if (!(x > -8388608.0f && x < 8388608.0f))
+			return x != x ? 0.0f : x;
+
+		float f = static_cast<float>(static_cast<int>(x));
+		return x < f ? f - 1.0f : f;
+	}
+
+	// Mip level for a footprint of rho texels, clamped to the level range.
+	float levelOfDetail(float rho) const
+	{
+		float lod = fastLog2(std::max(rho, 1e-6f));
+		return std::min(std::max(lod, 0.0f), static_cast<float>(m_levels.size() - 1));
+	}
+
+	/// Approximation of log2 for x > 0 with an absolute error below 0.005.
+	static float fastLog2(float x)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		float e = static_cast<float>(static_cast<int>(bits >> 23) - 128);
+
+		// Quadratic fit of log2 + 1 on the mantissa in [1, 2)
+		bits = (bits & 0x007fffff) | 0x3f800000;
+		float m;
+		std::memcpy(&m, &bits, sizeof(m));
+		return e + (-0.34484843f * m + 2.02466578f) * m - 0.67487759f;
+	}
+
+	static uint8_t getR(uint32_t color) { return (color >> 16) & 0xff; }
+	static uint8_t getG(uint32_t color) { return (color >> 8) & 0xff; }
+	static uint8_t getB(uint32_t color) { return color & 0xff; }
+
+	static uint32_t packRGB(uint8_t r, uint8_t g, uint8_t b)
+	{
+		return (r << 16) | (g << 8) | b;
+	}
+
+	// The weights below are in [0, 256]. Channel products stay below 2^16
+	// so the SSE2 versions work on unsigned 16 bit lanes and give the same
+	// results as the scalar ones.
+
+#ifdef SWR_USE_SSE2
+	/// Weigh the low four 16 bit lanes with 256 - t and the high four with
+	/// t, sum them and return the result in the low four lanes.
+	static __m128i lerpHalves(__m128i v, int t)
+	{
+		__m128i w = _mm_set_epi16(t, t, t, t, 256 - t, 256 - t, 256 - t, 256 - t);
+		v = _mm_mullo_epi16(v, w);
+		v = _mm_add_epi16(v, _mm_srli_si128(v, 8));
+		return _mm_srli_epi16(v, 8);
+	}
+
+	static uint32_t packLow(__m128i v)
+	{
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(v, v))) & 0x00ffffff;
+	}
+#endif
+
+	static uint32_t lerpColors(uint32_t c1, uint32_t c2, int t)
+	{
+#ifdef SWR_USE_SSE2
+		__m128i v = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(c1), _mm_cvtsi32_si128(c2)), _mm_setzero_si128());
+		return packLow(lerpHalves(v, t));
+#else
+		int r = (getR(c1) * (256 - t) + getR(c2) * t) >> 8;
+		int g = (getG(c1) * (256 - t) + getG(c2) * t) >> 8;
+		int b = (getB(c1) * (256 - t) + getB(c2) * t) >> 8;
+		return packRGB(r, g, b);
+#endif
+	}
+
+	static uint32_t bilinearLerpColors(uint32_t c00, uint32_t c10, uint32_t c01, uint32_t c11, int fx, int fy)
+	{
+#ifdef SWR_USE_SSE2
+		// Filter vertically with both columns in one register, then horizontally.
+		__m128i texels = _mm_set_epi32(c11, c01, c10, c00);
+		__m128i top = _mm_unpacklo_epi8(texels, _mm_setzero_si128());
+		__m128i bottom = _mm_unpackhi_epi8(texels, _mm_setzero_si128());
+		__m128i wy0 = _mm_set1_epi16(static_cast<short>(256 - fy));
+		__m128i wy1 = _mm_set1_epi16(static_cast<short>(fy));
+		__m128i columns = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(top, wy0), _mm_mullo_epi16(bottom, wy1)), 8);
+		return packLow(lerpHalves(columns, fx));
+#else
+		return lerpColors(lerpColors(c00, c01, fy), lerpColors(c10, c11, fy), fx);
+#endif
+	}
+
+	void layoutLevels(int width, int height, int levelCount, size_t unitsPerTile);
+	void generateMipmaps(const MipmapSettings &settings);
+	void halveRows(const Level &src, const Level &dst, int begin, int end);
+
+	std::vector<Level> m_levels;
+
+	// All levels, with each tile starting on a cache line boundary.
+	std::vector<uint32_t> m_storage;
+	uint32_t *m_texels;
+	TextureFormat m_format;
+	uint64_t m_id;          // tells textures apart in the decoded block cache
+	bool m_powerOfTwo;
+	int m_maxAnisotropy;
+};
+
+} // end namespace swr
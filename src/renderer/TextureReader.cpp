@@ -0,0 +1,251 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TextureReader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace swr {
+
+namespace {
+
+// Larger sizes in a header are treated as a corrupt file.
+const int MaxDimension = 1 << 16;
+
+uint32_t readU32(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+uint32_t fourCC(const char *code)
+{
+	return readU32((const unsigned char*)code);
+}
+
+bool readFile(const std::string &path, std::vector<unsigned char> &data)
+{
+	std::FILE *file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	bool ok = std::fseek(file, 0, SEEK_END) == 0;
+	long size = ok ? std::ftell(file) : -1;
+	ok = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+
+	if (ok)
+	{
+		data.resize(size);
+		ok = std::fread(data.data(), 1, data.size(), file) == data.size();
+	}
+
+	std::fclose(file);
+	return ok;
+}
+
+// Size of the blocks of a level in bytes.
+size_t levelSize(TextureFormat format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * Texture::blockBytes(format);
+}
+
+// Split the blocks of levelCount consecutive levels starting at data.
+bool readLevels(const unsigned char *data, size_t size, int levelCount, CompressedImage &image)
+{
+	image.levels.clear();
+
+	int width = image.width;
+	int height = image.height;
+
+	for (int i = 0; i < levelCount; ++i)
+	{
+		size_t bytes = levelSize(image.format, width, height);
+		if (bytes > size)
+			return false;
+
+		image.levels.push_back(std::vector<unsigned char>(data, data + bytes));
+		data += bytes;
+		size -= bytes;
+
+		if (width == 1 && height == 1)
+			break;
+
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return true;
+}
+
+bool readDDS(const std::vector<unsigned char> &file, CompressedImage &image)
+{
+	const size_t HeaderSize = 128;
+	const size_t DX10HeaderSize = 20;
+	const uint32_t MipMapCountFlag = 0x20000;
+	const uint32_t FourCCFlag = 0x4;
+
+	if (file.size() < HeaderSize || readU32(&file[0]) != fourCC("DDS "))
+		return false;
+
+	const unsigned char *header = &file[4];
+	uint32_t flags = readU32(header + 4);
+	int height = (int)readU32(header + 8);
+	int width = (int)readU32(header + 12);
+	uint32_t mipMapCount = readU32(header + 24);
+	uint32_t pixelFormatFlags = readU32(header + 76);
+	uint32_t code = readU32(header + 80);
+
+	if (!(pixelFormatFlags & FourCCFlag))
+		return false;
+
+	size_t dataOffset = HeaderSize;
+
+	if (code == fourCC("DXT1"))
+		image.format = TextureFormat::BC1;
+	else if (code == fourCC("DXT5"))
+		image.format = TextureFormat::BC3;
+	else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+		image.format = TextureFormat::BC4;
+	else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+		image.format = TextureFormat::BC5;
+	else if (code == fourCC("DX10"))
+	{
+		if (file.size() < HeaderSize + DX10HeaderSize)
+			return false;
+
+		const unsigned char *dx10 = &file[HeaderSize];
+		uint32_t dxgiFormat = readU32(dx10);
+		uint32_t dimension = readU32(dx10 + 4);
+		uint32_t arraySize = readU32(dx10 + 12);
+
+		// Only single 2D textures
+		if (dimension != 3 || arraySize > 1)
+			return false;
+
+		switch (dxgiFormat)
+		{
+			case 71: case 72: image.format = TextureFormat::BC1; break;
+			case 77: case 78: image.format = TextureFormat::BC3; break;
+			case 80: image.format = TextureFormat::BC4; break;
+			case 83: image.format = TextureFormat::BC5; break;
+			default: return false;
+		}
+
+		dataOffset += DX10HeaderSize;
+	}
+	else
+		return false;
+
+	if (width <= 0 || height <= 0 || width > MaxDimension || height > MaxDimension)
+		return false;
+
+	image.width = width;
+	image.height = height;
+
+	int levelCount = (flags & MipMapCountFlag) && mipMapCount > 0 ? (int)std::min(mipMapCount, 32u) : 1;
+	return readLevels(&file[dataOffset], file.size() - dataOffset, levelCount, image);
+}
+
+bool readKTX(const std::vector<unsigned char> &file, CompressedImage &image)
+{
+	static const unsigned char identifier[12] = { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+	const size_t HeaderSize = 64;
+
+	if (file.size() < HeaderSize || std::memcmp(&file[0], identifier, sizeof(identifier)) != 0)
+		return false;
+
+	const unsigned char *header = &file[12];
+
+	// Only little endian files
+	if (readU32(header) != 0x04030201)
+		return false;
+
+	uint32_t internalFormat = readU32(header + 16);
+	int width = (int)readU32(header + 24);
+	int height = (int)readU32(header + 28);
+	uint32_t depth = readU32(header + 32);
+	uint32_t arrayElements = readU32(header + 36);
+	uint32_t faces = readU32(header + 40);
+	uint32_t levelCount = std::max(readU32(header + 44), 1u);
+	uint32_t keyValueBytes = readU32(header + 48);
+
+	switch (internalFormat)
+	{
+		case 0x83f0: case 0x83f1: case 0x8c4c: case 0x8c4d: image.format = TextureFormat::BC1; break;
+		case 0x83f3: case 0x8c4f: image.format = TextureFormat::BC3; break;
+		case 0x8dbb: image.format = TextureFormat::BC4; break;
+		case 0x8dbd: image.format = TextureFormat::BC5; break;
+		default: return false;
+	}
+
+	if (width <= 0 || height <= 0 || width > MaxDimension || height > MaxDimension || depth > 0 || arrayElements > 0 || faces != 1)
+		return false;
+
+	image.width = width;
+	image.height = height;
+	image.levels.clear();
+
+	// Each level is preceded by its size and padded to 4 bytes.
+	size_t offset = HeaderSize + keyValueBytes;
+	int w = width;
+	int h = height;
+
+	for (uint32_t i = 0; i < levelCount && i < 32; ++i)
+	{
+		if (offset > file.size() || file.size() - offset < 4)
+			return false;
+
+		size_t imageSize = readU32(&file[offset]);
+		offset += 4;
+
+		if (imageSize != levelSize(image.format, w, h) || file.size() - offset < imageSize)
+			return false;
+
+		image.levels.push_back(std::vector<unsigned char>(&file[offset], &file[offset] + imageSize));
+		offset += (imageSize + 3) & ~(size_t)3;
+
+		if (w == 1 && h == 1)
+			break;
+
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+
+	return true;
+}
+
+} // end anonymous namespace
+
+bool readCompressedImage(const std::string &path, CompressedImage &image)
+{
+	std::vector<unsigned char> file;
+	if (!readFile(path, file))
+		return false;
+
+	return readDDS(file, image) || readKTX(file, image);
+}
+
+} // end namespace swr
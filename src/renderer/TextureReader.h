@@ -0,0 +1,54 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+
+namespace swr {
+
+/// Block compressed image with its mip levels.
+struct CompressedImage {
+	TextureFormat format;
+	int width;
+	int height;
+
+	/// Blocks of each mip level, row by row, starting with the full size level.
+	std::vector<std::vector<unsigned char> > levels;
+
+	CompressedImage() : format(TextureFormat::BC1), width(0), height(0) {}
+};
+
+/// Read a BC1, BC3, BC4 or BC5 compressed DDS or KTX file.
+/** The file type is detected from its contents. sRGB formats are read
+  like their linear counterparts. Returns false if the file could not be
+  read or does not hold a single 2D image in one of these formats. */
+bool readCompressedImage(const std::string &path, CompressedImage &image);
+
+} // end namespace swr
@@ -0,0 +1,240 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace swr {
+
+namespace {
+	struct ThreadContext {
+		const ThreadPool *pool;
+		int index;
+	};
+
+	thread_local ThreadContext currentThread = { nullptr, 0 };
+}
+
+ThreadPool::ThreadPool(const ThreadPoolConfig &config)
+	: m_threadCount(config.threadCount)
+	, m_affinityMask(config.affinityMask)
+	, m_executor(config.executor)
+	, m_queuedTasks(0)
+	, m_stop(false)
+{
+	if (m_threadCount <= 0)
+		m_threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+	// Queue 0 is shared by all threads which are not workers of this pool.
+	m_queues.reset(new TaskQueue[m_threadCount]);
+
+	if (m_executor)
+		return;
+
+	for (int i = 1; i < m_threadCount; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::workerMain, this, i);
+		setAffinity(m_workers.back(), i - 1);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (std::thread &t : m_workers)
+		t.join();
+}
+
+int ThreadPool::threadIndex() const
+{
+	return currentThread.pool == this ? currentThread.index : 0;
+}
+
+ThreadPool *ThreadPool::defaultPool()
+{
+	static ThreadPool pool;
+	return &pool;
+}
+
+void ThreadPool::run(int count, int grainSize, TaskFunc func, const void *context)
+{
+	grainSize = std::max(1, grainSize);
+	int chunkCount = (count + grainSize - 1) / grainSize;
+
+	Job job;
+	job.func = func;
+	job.context = context;
+	job.pending = chunkCount;
+
+	// Spread the chunks over all queues. Threads which finish early steal
+	// from the others.
+	int self = threadIndex();
+	for (int i = 0; i < chunkCount; ++i)
+	{
+		Task task;
+		task.job = &job;
+		task.begin = i * grainSize;
+		task.end = std::min(count, task.begin + grainSize);
+		pushTask((self + i) % m_threadCount, task);
+	}
+
+	if (m_executor)
+	{
+		int helpers = std::min(chunkCount, m_threadCount) - 1;
+		for (int i = 0; i < helpers; ++i)
+			m_executor([this]() { helpUntilEmpty(); });
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wakeUp.notify_all();
+	}
+
+	// Work on our own chunks first, then help everybody else until the job
+	// is complete. Helping with other jobs keeps nested calls deadlock free.
+	Task task;
+	while (job.pending.load(std::memory_order_acquire) > 0)
+	{
+		if (popTask(self, task) || stealTask(self, task))
+			runTask(task);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::workerMain(int index)
+{
+	currentThread.pool = this;
+	currentThread.index = index;
+
+	Task task;
+	while (!m_stop)
+	{
+		if (popTask(index, task) || stealTask(index, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeUp.wait(lock, [this]() { return m_stop || m_queuedTasks > 0; });
+	}
+}
+
+void ThreadPool::helpUntilEmpty()
+{
+	Task task;
+	while (stealTask(0, task))
+		runTask(task);
+}
+
+bool ThreadPool::popTask(int queueIndex, Task &task)
+{
+	TaskQueue &queue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+		return false;
+
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+	m_queuedTasks--;
+	return true;
+}
+
+bool ThreadPool::stealTask(int queueIndex, Task &task)
+{
+	for (int i = 1; i <= m_threadCount; ++i)
+	{
+		TaskQueue &queue = m_queues[(queueIndex + i) % m_threadCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+		m_queuedTasks--;
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::pushTask(int queueIndex, const Task &task)
+{
+	TaskQueue &queue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	queue.tasks.push_back(task);
+	m_queuedTasks++;
+}
+
+void ThreadPool::runTask(const Task &task)
+{
+	task.job->func(task.job->context, task.begin, task.end);
+	task.job->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void ThreadPool::setAffinity(std::thread &thread, int workerIndex)
+{
+	if (m_affinityMask == 0)
+		return;
+
+	// Pick the n-th set bit of the mask, wrapping around.
+	int bitCount = 0;
+	for (int i = 0; i < 64; ++i)
+		bitCount += (m_affinityMask >> i) & 1;
+
+	int n = workerIndex % bitCount;
+	int cpu = 0;
+	for (; cpu < 64; ++cpu)
+	{
+		if (((m_affinityMask >> cpu) & 1) && n-- == 0)
+			break;
+	}
+
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#elif defined(_WIN32)
+	SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu);
+#else
+	(void)cpu;
+#endif
+}
+
+} // end namespace swr
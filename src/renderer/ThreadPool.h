@@ -0,0 +1,162 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swr {
+
+/// Thread pool configuration.
+struct ThreadPoolConfig {
+	/// Number of threads taking part in parallel work, including the calling thread.
+	/** 0 uses the number of hardware threads. 1 runs everything on the calling thread. */
+	int threadCount;
+
+	/// CPU affinity of the worker threads.
+	/** Bit i allows a worker to run on CPU i. Workers are pinned to the set
+	  bits in round robin order. 0 leaves the affinity unchanged. */
+	std::uint64_t affinityMask;
+
+	/// Optional external task executor.
+	/** When set, the pool creates no threads of its own and submits helper
+	  tasks to this function instead. The executor must run every task it is
+	  given before the pool is destroyed. */
+	std::function<void(std::function<void()>)> executor;
+
+	ThreadPoolConfig()
+		: threadCount(0)
+		, affinityMask(0)
+	{
+	}
+};
+
+/// Work-stealing thread pool used for all parallel stages of the renderer.
+/** Each thread owns a task deque. Threads pop their own tasks LIFO and steal
+  from the other deques FIFO when they run out of work. The thread calling
+  parallelFor() always takes part in the work, so nested calls from inside a
+  task cannot deadlock. One pool can be shared by any number of Rasterizer
+  and VertexProcessor instances. */
+class ThreadPool {
+public:
+	/// Create a thread pool.
+	explicit ThreadPool(const ThreadPoolConfig &config = ThreadPoolConfig());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// Number of threads taking part in parallel work, including the calling thread.
+	int threadCount() const
+	{
+		return m_threadCount;
+	}
+
+	/// Index of the calling thread inside this pool.
+	/** Workers have indices 1 to threadCount() - 1. Any other thread,
+	  including external executor threads, returns 0. */
+	int threadIndex() const;
+
+	/// Call func(begin, end) for consecutive chunks covering [0, count).
+	/** Chunks contain at most grainSize elements. Returns when all chunks
+	  have been processed. Work smaller than one chunk runs directly on the
+	  calling thread without any synchronization. */
+	template <class Func>
+	void parallelFor(int count, int grainSize, const Func &func)
+	{
+		if (count <= 0)
+			return;
+
+		if (m_threadCount <= 1 || count <= grainSize)
+		{
+			func(0, count);
+			return;
+		}
+
+		run(count, grainSize, &invoke<Func>, &func);
+	}
+
+	/// The process wide pool used when no pool is given to the renderer.
+	/** Created on first use with the default configuration. */
+	static ThreadPool *defaultPool();
+
+private:
+	typedef void (*TaskFunc)(const void *context, int begin, int end);
+
+	struct Job {
+		TaskFunc func;
+		const void *context;
+		std::atomic<int> pending;
+	};
+
+	struct Task {
+		Job *job;
+		int begin;
+		int end;
+	};
+
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	template <class Func>
+	static void invoke(const void *context, int begin, int end)
+	{
+		(*static_cast<const Func*>(context))(begin, end);
+	}
+
+	void run(int count, int grainSize, TaskFunc func, const void *context);
+	void workerMain(int index);
+	void helpUntilEmpty();
+	bool popTask(int queueIndex, Task &task);
+	bool stealTask(int queueIndex, Task &task);
+	void pushTask(int queueIndex, const Task &task);
+	void runTask(const Task &task);
+	void setAffinity(std::thread &thread, int workerIndex);
+
+	int m_threadCount;
+	std::uint64_t m_affinityMask;
+	std::function<void(std::function<void()>)> m_executor;
+
+	std::unique_ptr<TaskQueue[]> m_queues;
+	std::vector<std::thread> m_workers;
+
+	std::atomic<int> m_queuedTasks;
+	std::atomic<bool> m_stop;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeUp;
+};
+
+} // end namespace swr
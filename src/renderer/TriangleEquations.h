@@ -26,6 +26,7 @@ SOFTWARE.
 
 #include "IRasterizer.h"
 #include "ParameterEquation.h"
+#include "TriangleSetup.h"
 
 namespace swr {
 
@@ -44,18 +45,17 @@ struct TriangleEquations {
 	ParameterEquation avar[MaxAVars];
 	ParameterEquation pvar[MaxPVars];
 
-	TriangleEquations(const RasterizerVertex &v0, const RasterizerVertex &v1, const RasterizerVertex &v2, int aVarCount, int pVarCount)
+	/// Compute the parameter equations for a triangle that passed the setup stage.
+	TriangleEquations(const TriangleSetup &setup, int aVarCount, int pVarCount)
+		: area2(setup.area2)
+		, e0(setup.e0)
+		, e1(setup.e1)
+		, e2(setup.e2)
 	{
-		e0.init(v1, v2);
-		e1.init(v2, v0);
-		e2.init(v0, v1);
+		const RasterizerVertex &v0 = *setup.v0;
+		const RasterizerVertex &v1 = *setup.v1;
+		const RasterizerVertex &v2 = *setup.v2;
 
-		area2 = e0.c + e1.c + e2.c;
-
-		// Cull backfacing triangles.
-		if (area2 <= 0)
-			return;
-		
 		float factor = 1.0f / area2;
 		z.init(v0.z, v1.z, v2.z, e0, e1, e2, factor);
 
@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2017-2020 Markus Trenkwalder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+/** @file */
+
+#include <algorithm>
+
+#include "IRasterizer.h"
+#include "EdgeEquation.h"
+
+namespace swr {
+
+#pragma warning(push)
+#pragma warning(disable: 26495) // variable in uninitialized
+
+/// Scissor rectangle used by the triangle setup stage.
+/** The max values are exclusive. */
+struct ScissorRect {
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+};
+
+/// Output of the triangle setup stage.
+/** The setup stage computes the signed area, culls back facing and zero
+  area triangles, rejects triangles outside the scissor rect and computes
+  the edge equations once per triangle. Vertices are stored in an order
+  that gives a positive area, so the raster loops never have to re-check. */
+struct TriangleSetup {
+	const RasterizerVertex *v0;
+	const RasterizerVertex *v1;
+	const RasterizerVertex *v2;
+
+	EdgeEquation e0;
+	EdgeEquation e1;
+	EdgeEquation e2;
+
+	/// Twice the triangle area. Always positive after a successful init.
+	float area2;
+
+	/// Pixel bounding box clipped to the scissor rect. The max values are inclusive.
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+
+	/// Set up a triangle. Returns false if the triangle was rejected.
+	bool init(const RasterizerVertex &va, const RasterizerVertex &vb, const RasterizerVertex &vc, CullMode cullMode, const ScissorRect &scissor)
+	{
+		// Bounding box first, it is the cheapest rejection test.
+		minX = std::max((int)std::min(std::min(va.x, vb.x), vc.x), scissor.minX);
+		maxX = std::min((int)std::max(std::max(va.x, vb.x), vc.x), scissor.maxX - 1);
+		minY = std::max((int)std::min(std::min(va.y, vb.y), vc.y), scissor.minY);
+		maxY = std::min((int)std::max(std::max(va.y, vb.y), vc.y), scissor.maxY - 1);
+
+		if (minX > maxX || minY > maxY)
+			return false;
+
+		e0.init(vb, vc);
+		e1.init(vc, va);
+		e2.init(va, vb);
+
+		area2 = e0.c + e1.c + e2.c;
+
+		if (area2 > 0)
+		{
+			if (cullMode == CullMode::CW)
+				return false;
+
+			v0 = &va;
+			v1 = &vb;
+			v2 = &vc;
+		}
+		else if (area2 < 0)
+		{
+			if (cullMode == CullMode::CCW)
+				return false;
+
+			// Swap v0 and v2. This reverses and renumbers the edges.
+			EdgeEquation t = e0;
+			e0.flip(e2);
+			e1.flip(e1);
+			e2.flip(t);
+			area2 = -area2;
+
+			v0 = &vc;
+			v1 = &vb;
+			v2 = &va;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+};
+
+#pragma warning(pop)
+
+} // end namespace swr
@@ -26,10 +26,12 @@ SOFTWARE.
 
 namespace swr {
 
+/// Direct mapped cache of shaded vertices, indexed by vertex index modulo its size.
 class VertexCache {
-private:
+public:
 	static const int VertexCacheSize = 16;
 
+private:
 	int inputIndex[VertexCacheSize];
 	int outputIndex[VertexCacheSize];
 
@@ -23,12 +23,21 @@ SOFTWARE.
 */
 
 #include "VertexProcessor.h"
+#include "PipelineStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace swr {
 
-VertexProcessor::VertexProcessor(IRasterizer *rasterizer)
+VertexProcessor::VertexProcessor(IRasterizer *rasterizer, ThreadPool *threadPool)
+	: m_threadPool(threadPool ? threadPool : ThreadPool::defaultPool())
+	, m_hiZBuffer(nullptr)
+	, m_clipPrimitives(true)
 {
 	setRasterizer(rasterizer);
+	setViewport(0, 0, 0, 0);
 	setCullMode(CullMode::CW);
 	setDepthRange(0.0f, 1.0f);
 	setVertexShader<DummyVertexShader>();
@@ -53,6 +62,14 @@ void VertexProcessor::setViewport(int x, int y, int width, int height)
 	m_viewport.oy = (y + m_viewport.py);
 }
 
+void VertexProcessor::getViewport(int &x, int &y, int &width, int &height) const
+{
+	x = m_viewport.x;
+	y = m_viewport.y;
+	width = m_viewport.width;
+	height = m_viewport.height;
+}
+
 void VertexProcessor::setDepthRange(float n, float f)
 {
 	m_depthRange.n = n;
@@ -75,48 +92,173 @@ void VertexProcessor::setVertexAttribPointer(int index, int stride, const void *
 	#pragma warning (pop)
 }
 
-void VertexProcessor::drawElements(DrawMode mode, size_t count, int *indices) const
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const int *indices) const
+{
+	drawElementsTemplate(mode, count, indices);
+}
+
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const uint16_t *indices) const
+{
+	drawElementsTemplate(mode, count, indices);
+}
+
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const int *indices, const BoundingBox &bounds, const float *clipMatrix) const
+{
+	drawElementsBounded(mode, count, indices, bounds, clipMatrix);
+}
+
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const int *indices, const BoundingSphere &bounds, const float *clipMatrix) const
+{
+	drawElementsBounded(mode, count, indices, bounds, clipMatrix);
+}
+
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const uint16_t *indices, const BoundingBox &bounds, const float *clipMatrix) const
+{
+	drawElementsBounded(mode, count, indices, bounds, clipMatrix);
+}
+
+void VertexProcessor::drawElements(DrawMode mode, size_t count, const uint16_t *indices, const BoundingSphere &bounds, const float *clipMatrix) const
+{
+	drawElementsBounded(mode, count, indices, bounds, clipMatrix);
+}
+
+template <class Index, class Bounds>
+void VertexProcessor::drawElementsBounded(DrawMode mode, size_t count, const Index *indices, const Bounds &bounds, const float *clipMatrix) const
+{
+	Visibility visibility = Frustum(clipMatrix).classify(bounds);
+	if (visibility == Visibility::Outside)
+		return;
+
+	m_clipPrimitives = visibility != Visibility::Inside;
+	drawElementsTemplate(mode, count, indices);
+	m_clipPrimitives = true;
+}
+
+void VertexProcessor::setHiZBuffer(const HiZBuffer *hiZBuffer)
+{
+	m_hiZBuffer = hiZBuffer;
+}
+
+size_t VertexProcessor::drawMeshlets(const Meshlet *meshlets, size_t meshletCount, const int *indices, const float *clipMatrix) const
 {
-	m_verticesOut.clear();
+	Frustum frustum(clipMatrix);
+
+	m_vertexInputIndices.clear();
 	m_indicesOut.clear();
 
-	// TODO: Max 1024 primitives per batch.
 	VertexCache vCache;
+	size_t drawn = 0;
+
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		const Meshlet &meshlet = meshlets[i];
+
+		if (frustum.classify(meshlet.bounds) == Visibility::Outside
+			|| frustum.isBackFacing(meshlet, m_cullMode)
+			|| isOccluded(frustum, meshlet.bounds))
+			continue;
 
+		appendElements(DrawMode::Triangle, (size_t)meshlet.triangleCount * 3, indices + meshlet.firstIndex, vCache);
+		drawn++;
+	}
+
+	if (!m_indicesOut.empty())
+		processPrimitives(DrawMode::Triangle);
+
+	return drawn;
+}
+
+template <class Index>
+void VertexProcessor::drawElementsTemplate(DrawMode mode, size_t count, const Index *indices) const
+{
+	m_vertexInputIndices.clear();
+	m_indicesOut.clear();
+
+	VertexCache vCache;
+	appendElements(mode, count, indices, vCache);
+
+	if (!m_indicesOut.empty())
+		processPrimitives(mode);
+}
+
+template <class Index>
+void VertexProcessor::appendElements(DrawMode mode, size_t count, const Index *indices, VertexCache &vCache) const
+{
+	SWR_STATISTICS_ADD(verticesFetched, count);
+
+	// The cache lookup only assigns output slots. The vertices of a batch
+	// are shaded in parallel in processVertices().
 	for (size_t i = 0; i < count; i++)
 	{
-		int index = indices[i];
+		int index = (int)indices[i];
 		int outputIndex = vCache.lookup(index);
 		
-		if (outputIndex != -1)
+		if (outputIndex == -1)
 		{
-			m_indicesOut.push_back(outputIndex);
+			outputIndex = (int)m_vertexInputIndices.size();
+			m_vertexInputIndices.push_back(index);
+			vCache.set(index, outputIndex);
 		}
 		else
 		{
-			VertexShaderInput vIn;    
-			initVertexInput(vIn, index);
-
-			int outputIndex = (int)m_verticesOut.size();
-			m_indicesOut.push_back(outputIndex);
-			m_verticesOut.resize(m_verticesOut.size() + 1);
-			VertexShaderOutput &vOut = m_verticesOut.back();
-			
-			processVertex(vIn, &vOut);
-
-			vCache.set(index, outputIndex);
+			SWR_STATISTICS_ADD(vertexCacheHits, 1);
 		}
 
-		if (primitiveCount(mode) >= 1024)
+		m_indicesOut.push_back(outputIndex);
+
+		if (primitiveCount(mode) >= BatchPrimitiveCount)
 		{
 			processPrimitives(mode);
-			m_verticesOut.clear();
+			m_vertexInputIndices.clear();
 			m_indicesOut.clear();
 			vCache.clear();
 		}
 	}
+}
+
+bool VertexProcessor::isOccluded(const Frustum &frustum, const BoundingSphere &sphere) const
+{
+	if (!m_hiZBuffer || !m_hiZBuffer->isValid())
+		return false;
+
+	// Screen rectangle and nearest depth of the corners of the box around
+	// the sphere
+	float minX = std::numeric_limits<float>::max(), maxX = -minX;
+	float minY = minX, maxY = -minX;
+	float minZ = minX;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		float position[3], clip[4];
+		for (int i = 0; i < 3; ++i)
+			position[i] = sphere.center[i] + (corner & (1 << i) ? sphere.radius : -sphere.radius);
+
+		frustum.transform(position, clip);
+
+		// Reaches behind the eye, the rectangle is unbounded
+		if (clip[3] <= 0.0f)
+			return false;
+
+		float invW = 1.0f / clip[3];
+		float x = m_viewport.px * clip[0] * invW + m_viewport.ox;
+		float y = m_viewport.py * -clip[1] * invW + m_viewport.oy;
+		float z = 0.5f * (m_depthRange.f - m_depthRange.n) * clip[2] * invW + 0.5f * (m_depthRange.n + m_depthRange.f);
+
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, z);
+	}
+
+	// Clamped so the conversion to int can not overflow
+	const float limit = 1 << 30;
+	int x0 = (int)std::floor(std::max(minX, -limit));
+	int y0 = (int)std::floor(std::max(minY, -limit));
+	int x1 = (int)std::floor(std::min(maxX, limit));
+	int y1 = (int)std::floor(std::min(maxY, limit));
 
-	processPrimitives(mode);
+	return m_hiZBuffer->isOccluded(x0, y0, x1, y1, minZ);
 }
 
 int VertexProcessor::clipMask(VertexShaderOutput &v) const
@@ -138,39 +280,50 @@ const void *VertexProcessor::attribPointer(int attribIndex, int elementIndex) co
 	return (char*)attrib.buffer + offset;
 }
 
-void VertexProcessor::processVertex(VertexShaderInput in, VertexShaderOutput *out) const
-{
-	(*m_processVertexFunc)(in, out);
-}
-
 void VertexProcessor::initVertexInput(VertexShaderInput in, int index) const
 {
 	for (int i = 0; i < m_attribCount; ++i)
 		in[i] = attribPointer(i, index);
 }
 
-void VertexProcessor::clipPoints() const
+void VertexProcessor::processVertices() const
+{
+	m_verticesOut.resize(m_vertexInputIndices.size());
+	SWR_STATISTICS_ADD(verticesShaded, m_verticesOut.size());
+
+	m_threadPool->parallelFor((int)m_verticesOut.size(), VertexGrainSize, [this](int begin, int end) {
+		(this->*m_processVerticesFunc)(begin, end);
+	});
+}
+
+void VertexProcessor::computeClipMasks() const
 {
 	m_clipMask.clear();
 	m_clipMask.resize(m_verticesOut.size());
-	
-	for (size_t i = 0; i < m_verticesOut.size(); i++)
-		m_clipMask[i] = clipMask(m_verticesOut[i]);
+
+	m_threadPool->parallelFor((int)m_verticesOut.size(), VertexGrainSize, [this](int begin, int end) {
+		for (int i = begin; i < end; i++)
+			m_clipMask[i] = clipMask(m_verticesOut[i]);
+	});
+}
+
+void VertexProcessor::clipPoints() const
+{
+	computeClipMasks();
 
 	for (size_t i = 0; i < m_indicesOut.size(); i++)
 	{
 		if (m_clipMask[m_indicesOut[i]])    
+		{
 			m_indicesOut[i] = -1;
+			SWR_STATISTICS_ADD(primitivesCulled, 1);
+		}
 	}
 }
 
 void VertexProcessor::clipLines() const
 {
-	m_clipMask.clear();
-	m_clipMask.resize(m_verticesOut.size());
-
-	for (size_t i = 0; i < m_verticesOut.size(); i++)
-		m_clipMask[i] = clipMask(m_verticesOut[i]);
+	computeClipMasks();
 
 	for (size_t i = 0; i < m_indicesOut.size(); i += 2)
 	{
@@ -191,13 +344,20 @@ void VertexProcessor::clipLines() const
 		if (clipMask & ClipMask::PosZ) lineClipper.clipToPlane( 0, 0,-1, 1);
 		if (clipMask & ClipMask::NegZ) lineClipper.clipToPlane( 0, 0, 1, 1);
 
+		if (clipMask)
+			SWR_STATISTICS_ADD(primitivesClipped, 1);
+
 		if (lineClipper.fullyClipped)
 		{
 			m_indicesOut[i] = -1;
 			m_indicesOut[i + 1] = -1;
+			SWR_STATISTICS_ADD(primitivesCulled, 1);
 			continue;
 		}
 
+		if (clipMask)
+			SWR_STATISTICS_ADD(clipperOutput, 1);
+
 		if (m_clipMask[index0])
 		{
 			VertexShaderOutput newV = Helper::interpolateVertex(v0, v1, lineClipper.t0, m_avarCount, m_pvarCount);
@@ -216,11 +376,7 @@ void VertexProcessor::clipLines() const
 
 void VertexProcessor::clipTriangles() const
 {
-	m_clipMask.clear();
-	m_clipMask.resize(m_verticesOut.size());
-
-	for (size_t i = 0; i < m_verticesOut.size(); i++)
-		m_clipMask[i] = clipMask(m_verticesOut[i]);
+	computeClipMasks();
 
 	size_t n = m_indicesOut.size();
 
@@ -241,15 +397,21 @@ void VertexProcessor::clipTriangles() const
 		if (clipMask & ClipMask::PosZ) polyClipper.clipToPlane( 0, 0,-1, 1);
 		if (clipMask & ClipMask::NegZ) polyClipper.clipToPlane( 0, 0, 1, 1);
 
+		if (clipMask)
+			SWR_STATISTICS_ADD(primitivesClipped, 1);
+
 		if (polyClipper.fullyClipped())
 		{
 			m_indicesOut[i] = -1;
 			m_indicesOut[i + 1] = -1;
 			m_indicesOut[i + 2] = -1;
+			SWR_STATISTICS_ADD(primitivesCulled, 1);
 			continue;
 		}
 
 		std::vector<int> &indices = polyClipper.indices();
+		if (clipMask)
+			SWR_STATISTICS_ADD(clipperOutput, indices.size() - 2);
 
 		m_indicesOut[i] = indices[0];
 		m_indicesOut[i + 1] = indices[1];
@@ -280,8 +442,10 @@ void VertexProcessor::clipPrimitives(DrawMode mode) const
 
 void VertexProcessor::processPrimitives(DrawMode mode) const
 {
-	clipPrimitives(mode);
-	transformVertices();
+	SWR_STATISTICS_TIME(vertexNs, processVertices());
+	if (m_clipPrimitives)
+		SWR_STATISTICS_TIME(clipNs, clipPrimitives(mode));
+	SWR_STATISTICS_TIME(vertexNs, transformVertices());
 	drawPrimitives(mode);
 }
 
@@ -304,8 +468,7 @@ void VertexProcessor::drawPrimitives(DrawMode mode) const
 	switch (mode)
 	{
 		case DrawMode::Triangle:
-			cullTriangles();
-			m_rasterizer->drawTriangleList(&m_verticesOut[0], &m_indicesOut[0], m_indicesOut.size());
+			m_rasterizer->drawTriangleList(&m_verticesOut[0], &m_indicesOut[0], m_indicesOut.size(), m_cullMode);
 			break;
 		case DrawMode::Line:
 			m_rasterizer->drawLineList(&m_verticesOut[0], &m_indicesOut[0], m_indicesOut.size());
@@ -316,64 +479,38 @@ void VertexProcessor::drawPrimitives(DrawMode mode) const
 	}
 }
 
-void VertexProcessor::cullTriangles() const
-{
-	for (size_t i = 0; i + 3 <= m_indicesOut.size(); i += 3)
-	{
-		if (m_indicesOut[i] == -1)
-			continue;
-
-		VertexShaderOutput &v0 = m_verticesOut[m_indicesOut[i]];
-		VertexShaderOutput &v1 = m_verticesOut[m_indicesOut[i + 1]];
-		VertexShaderOutput &v2 = m_verticesOut[m_indicesOut[i + 2]];
-
-		float facing = (v0.x - v1.x) * (v2.y - v1.y) - (v2.x - v1.x) * (v0.y - v1.y);
-
-		if (facing < 0)
-		{
-			if (m_cullMode == CullMode::CW)
-				m_indicesOut[i] = m_indicesOut[i + 1] = m_indicesOut[i + 2] = -1;
-		}
-		else
-		{
-			if (m_cullMode == CullMode::CCW)
-				m_indicesOut[i] = m_indicesOut[i + 1] = m_indicesOut[i + 2] = -1;
-			else
-				std::swap(m_indicesOut[i], m_indicesOut[i + 2]);
-		}
-	}
-}
-
 void VertexProcessor::transformVertices() const
 {
-	m_alreadyProcessed.clear();
-	m_alreadyProcessed.resize(m_verticesOut.size());
+	m_vertexUsed.clear();
+	m_vertexUsed.resize(m_verticesOut.size());
 
 	for (size_t i = 0; i < m_indicesOut.size(); i++)
 	{
 		int index = m_indicesOut[i];
+		if (index != -1)
+			m_vertexUsed[index] = 1;
+	}
 
-		if (index == -1)
-			continue;
-
-		if (m_alreadyProcessed[index])
-			continue;
-
-		VertexShaderOutput &vOut = m_verticesOut[index];
+	m_threadPool->parallelFor((int)m_verticesOut.size(), VertexGrainSize, [this](int begin, int end) {
+		for (int i = begin; i < end; i++)
+		{
+			if (!m_vertexUsed[i])
+				continue;
 
-		// Perspective divide
-		float invW = 1.0f / vOut.w;
-		vOut.x *= invW;
-		vOut.y *= invW;
-		vOut.z *= invW;
+			VertexShaderOutput &vOut = m_verticesOut[i];
 
-		// Viewport transform
-		vOut.x = (m_viewport.px * vOut.x + m_viewport.ox);
-		vOut.y = (m_viewport.py * -vOut.y + m_viewport.oy);
-		vOut.z = 0.5f * (m_depthRange.f - m_depthRange.n) * vOut.z + 0.5f * (m_depthRange.n + m_depthRange.f);
+			// Perspective divide
+			float invW = 1.0f / vOut.w;
+			vOut.x *= invW;
+			vOut.y *= invW;
+			vOut.z *= invW;
 
-		m_alreadyProcessed[index] = true;
-	}
+			// Viewport transform
+			vOut.x = (m_viewport.px * vOut.x + m_viewport.ox);
+			vOut.y = (m_viewport.py * -vOut.y + m_viewport.oy);
+			vOut.z = 0.5f * (m_depthRange.f - m_depthRange.n) * vOut.z + 0.5f * (m_depthRange.n + m_depthRange.f);
+		}
+	});
 }
 
 } // end namespace swr
\ No newline at end of file
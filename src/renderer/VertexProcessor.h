@@ -28,6 +28,7 @@ SOFTWARE.
 
 #include <vector>
 #include <cassert>
+#include <cstdint>
 
 #include "IRasterizer.h"
 #include "VertexConfig.h"
@@ -35,6 +36,9 @@ SOFTWARE.
 #include "PolyClipper.h"
 #include "VertexShaderBase.h"
 #include "VertexCache.h"
+#include "ThreadPool.h"
+#include "Culling.h"
+#include "HiZBuffer.h"
 
 namespace swr {
 
@@ -45,18 +49,18 @@ enum class DrawMode {
 	Triangle
 };
 
-/// Triangle culling mode.
-enum class CullMode {
-	None,
-	CCW,
-	CW
-};
-
 /// Process vertices and pass them to a rasterizer.
 class VertexProcessor {
 public:
+	/// Primitives per batch.
+	/** drawElements() shades and draws the primitives in batches of this
+	  size. The vertex cache is cleared at the start of each batch. */
+	static const int BatchPrimitiveCount = 1024;
+
 	/// Constructor.
-	VertexProcessor(IRasterizer *rasterizer);
+	/** Parallel stages run on the given thread pool. If threadPool is
+	  nullptr the process wide ThreadPool::defaultPool() is used. */
+	VertexProcessor(IRasterizer *rasterizer, ThreadPool *threadPool = nullptr);
 
 	/// Change the rasterizer where the primitives are sent.
 	void setRasterizer(IRasterizer *rasterizer);
@@ -65,6 +69,9 @@ public:
 	/** Top-Left is (0, 0) */
 	void setViewport(int x, int y, int width, int height);
 
+	/// Get the viewport set by setViewport().
+	void getViewport(int &x, int &y, int &width, int &height) const;
+
 	/// Set the depth range.
 	/** Default is (0, 1) */
 	void setDepthRange(float n, float f);
@@ -74,21 +81,70 @@ public:
 	void setCullMode(CullMode mode);
 
 	/// Set the vertex shader.
+	/** The shader instance is not copied and must stay alive while it is
+	  bound. Each vertex processor can use its own instance, which allows
+	  several vertex processors to run concurrently with different state. */
 	template <class VertexShader>
-	void setVertexShader()
+	void setVertexShader(const VertexShader *shader)
 	{
 		assert(VertexShader::AttribCount <= MaxVertexAttribs);
 		m_avarCount = VertexShader::AVarCount;
 		m_pvarCount = VertexShader::PVarCount;
 		m_attribCount = VertexShader::AttribCount;
-		m_processVertexFunc = VertexShader::processVertex;
+		m_vertexShader = shader;
+		m_processVerticesFunc = &VertexProcessor::processVerticesTemplate<VertexShader>;
+	}
+
+	/// Set a vertex shader without state.
+	/** Binds a default constructed instance shared by all vertex processors. */
+	template <class VertexShader>
+	void setVertexShader()
+	{
+		static VertexShader shader;
+		setVertexShader(&shader);
 	}
 
 	/// Set a vertex attrib pointer.
 	void setVertexAttribPointer(int index, int stride, const void *buffer);
 	
 	/// Draw a number of points, lines or triangles.
-	void drawElements(DrawMode mode, size_t count, int *indices) const;
+	void drawElements(DrawMode mode, size_t count, const int *indices) const;
+
+	/// Draw a number of points, lines or triangles with 16 bit indices.
+	void drawElements(DrawMode mode, size_t count, const uint16_t *indices) const;
+
+	/// Draw a number of points, lines or triangles within bounds.
+	/** bounds must enclose every position referenced by the indices in
+	  object space. This is not checked: with bounds that are too small,
+	  primitives reaching out of the frustum are drawn without clipping.
+	  clipMatrix is the object to clip space transform applied by the
+	  vertex shader, see Frustum. Nothing is processed if the bounds are
+	  outside the frustum, and clipping is skipped if they are inside.
+	  Like the other draws, this must not be called from several threads
+	  at once on the same processor. */
+	void drawElements(DrawMode mode, size_t count, const int *indices, const BoundingBox &bounds, const float *clipMatrix) const;
+
+	/// Draw a number of points, lines or triangles within bounds.
+	void drawElements(DrawMode mode, size_t count, const int *indices, const BoundingSphere &bounds, const float *clipMatrix) const;
+
+	/// Draw a number of points, lines or triangles with 16 bit indices within bounds.
+	void drawElements(DrawMode mode, size_t count, const uint16_t *indices, const BoundingBox &bounds, const float *clipMatrix) const;
+
+	/// Draw a number of points, lines or triangles with 16 bit indices within bounds.
+	void drawElements(DrawMode mode, size_t count, const uint16_t *indices, const BoundingSphere &bounds, const float *clipMatrix) const;
+
+	/// Set a Hi-Z buffer for occlusion culling in drawMeshlets().
+	/** The buffer is not copied and must stay alive while it is set.
+	  nullptr disables occlusion culling. */
+	void setHiZBuffer(const HiZBuffer *hiZBuffer);
+
+	/// Draw the triangles of meshlets, culling whole meshlets first.
+	/** clipMatrix is the object to clip space transform applied by the
+	  vertex shader, see Frustum. Meshlets outside the frustum, facing away
+	  according to the cull mode or hidden behind the Hi-Z buffer are
+	  skipped before any of their vertices is shaded. Returns the number of
+	  meshlets drawn. */
+	size_t drawMeshlets(const Meshlet *meshlets, size_t meshletCount, const int *indices, const float *clipMatrix) const;
 
 private:
 	struct ClipMask {
@@ -102,10 +158,35 @@ private:
 		};
 	};
 
+	template <class Index>
+	void drawElementsTemplate(DrawMode mode, size_t count, const Index *indices) const;
+
+	template <class Index, class Bounds>
+	void drawElementsBounded(DrawMode mode, size_t count, const Index *indices, const Bounds &bounds, const float *clipMatrix) const;
+
+	template <class Index>
+	void appendElements(DrawMode mode, size_t count, const Index *indices, VertexCache &vCache) const;
+
+	bool isOccluded(const Frustum &frustum, const BoundingSphere &sphere) const;
+
 	int clipMask(VertexShaderOutput &v) const;
 	const void *attribPointer(int attribIndex, int elementIndex) const;
-	void processVertex(VertexShaderInput in, VertexShaderOutput *out) const;
 	void initVertexInput(VertexShaderInput in, int index) const;
+	void processVertices() const;
+
+	template <class VertexShader>
+	void processVerticesTemplate(int begin, int end) const
+	{
+		const VertexShader *shader = static_cast<const VertexShader*>(m_vertexShader);
+
+		VertexShaderInput vIn;
+		for (int i = begin; i < end; ++i)
+		{
+			initVertexInput(vIn, m_vertexInputIndices[i]);
+			shader->processVertex(vIn, &m_verticesOut[i]);
+		}
+	}
+	void computeClipMasks() const;
 
 	void clipPoints() const;
 	void clipLines() const;
@@ -116,10 +197,14 @@ private:
 	int primitiveCount(DrawMode mode) const;
 
 	void drawPrimitives(DrawMode mode) const;
-	void cullTriangles() const;
 	void transformVertices() const;
 
 private:
+	// Number of vertices per parallel task.
+	static const int VertexGrainSize = 256;
+
+	ThreadPool *m_threadPool;
+
 	struct {
 		int x, y, width, height;
 		float px, py, ox, oy;
@@ -131,8 +216,14 @@ private:
 
 	CullMode m_cullMode;
 	IRasterizer *m_rasterizer;
+	const HiZBuffer *m_hiZBuffer;
+
+	// False while drawing primitives known to be inside the frustum.
+	// Draws change it, so they must not run concurrently on one processor.
+	mutable bool m_clipPrimitives;
 	
-	void (*m_processVertexFunc)(VertexShaderInput, VertexShaderOutput*);
+	const void *m_vertexShader;
+	void (VertexProcessor::*m_processVerticesFunc)(int begin, int end) const;
 	
 	int m_attribCount;
 	int m_avarCount;
@@ -145,10 +236,11 @@ private:
 
 	// Some temporary variables for speed
 	mutable PolyClipper polyClipper;
+	mutable std::vector<int> m_vertexInputIndices;
 	mutable std::vector<VertexShaderOutput> m_verticesOut;
 	mutable std::vector<int> m_indicesOut;
 	mutable std::vector<int> m_clipMask;
-	mutable std::vector<bool> m_alreadyProcessed;
+	mutable std::vector<char> m_vertexUsed;
 };
 
 } // end namespace swr
\ No newline at end of file
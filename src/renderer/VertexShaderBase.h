@@ -29,7 +29,11 @@ SOFTWARE.
 namespace swr {
 
 /// Base class for vertex shaders.
-/** Derive your own vertex shaders from this class and redefine AttribCount etc. */
+/** Derive your own vertex shaders from this class and redefine AttribCount etc.
+  Shader state such as matrices lives in the shader instance, which is bound
+  to a VertexProcessor with VertexProcessor::setVertexShader(). The same
+  instance is used from multiple threads, so processVertex() must not
+  modify it. */
 template <class Derived>
 class VertexShaderBase {
 public:
@@ -44,7 +48,7 @@ public:
 
 	/// Process a single vertex.
 	/** Implement this in your own vertex shader. */
-	static void processVertex(VertexShaderInput in, VertexShaderOutput *out)
+	void processVertex(VertexShaderInput in, VertexShaderOutput *out) const
 	{
 
 	}